@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+
+# Compare two google benchmark JSON outputs, e.g. the committed baseline and a new run of microbench:
+#   python3 bench/compare.py bench/baseline.json new.json [threshold]
+# Prints the CPU time of each benchmark in both, and their ratio. Exits with status 1 if any benchmark is slower
+# than the baseline by more than the threshold (default 0.10, i.e. 10%).
+# With repetitions, the median of each benchmark is compared.
+# Exits with status 2 if either run was made with a debug build of google benchmark, and warns if either was made
+# on a machine that was busy (load average at or above its number of CPUs), since neither is a usable measurement.
+
+import json
+import sys
+
+def cpuTimes(path):
+    with open(path) as f:
+        report = json.load(f)
+    times = {}
+    medians = {}
+    for b in report['benchmarks']:
+        if b.get('run_type') == 'aggregate':
+            if b.get('aggregate_name') == 'median':
+                medians[b['run_name']] = b['cpu_time']
+        else:
+            times.setdefault(b['name'], b['cpu_time'])
+    times.update(medians)
+    return times, report['context']
+
+def checkContext(path, context):
+    usable = True
+    if context.get('library_build_type') == 'debug':
+        print(f'{path}: recorded with a debug build of google benchmark; rebuild it in release and re-run')
+        usable = False
+    loadAvg = context.get('load_avg') or [0.0]
+    numCpus = context.get('num_cpus', 1)
+    if loadAvg[0] >= numCpus:
+        print(f'Warning: {path}: recorded with load average {loadAvg[0]:.1f} on {numCpus} CPU(s); the timings are noisy')
+    return usable
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        print('Usage: compare.py <baseline.json> <new.json> [threshold]')
+        sys.exit(2)
+    threshold = float(sys.argv[3]) if len(sys.argv) == 4 else 0.10
+
+    base, baseContext = cpuTimes(sys.argv[1])
+    new, newContext = cpuTimes(sys.argv[2])
+    if not (checkContext(sys.argv[1], baseContext) & checkContext(sys.argv[2], newContext)):
+        sys.exit(2)
+    if baseContext.get('host_name') != newContext.get('host_name'):
+        print(f"Warning: comparing runs from different hosts ({baseContext.get('host_name')}, {newContext.get('host_name')})")
+
+    regressions = 0
+    print(f"{'benchmark':40s} {'baseline':>12s} {'new':>12s} {'ratio':>7s}")
+    for name in sorted(set(base) | set(new)):
+        if name not in base or name not in new:
+            print(f"{name:40s} {'only in ' + ('baseline' if name in base else 'new'):>33s}")
+            continue
+        ratio = new[name] / base[name]
+        flag = ''
+        if ratio > 1.0 + threshold:
+            flag = '  SLOWER'
+            regressions += 1
+        elif ratio < 1.0 - threshold:
+            flag = '  faster'
+        print(f'{name:40s} {base[name]:12.1f} {new[name]:12.1f} {ratio:7.3f}{flag}')
+
+    if regressions:
+        print(f'{regressions} benchmark(s) slower than the baseline by more than {threshold:.0%}')
+        sys.exit(1)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,170 @@
+// bench/microbench.cpp
+// Microbenchmarks of the engine's hot paths, in the google benchmark framework.
+//
+// Every position is reached from one fixed deal by a fixed rule (the play number selects among the legal plays), so
+// the positions do not depend on RandomGenerator and runs on the same machine are comparable.
+// Position benchmarks take the play number as their argument: 6 (early), 22 (middle) and 38 (late), each the third
+// card of a trick. `make microbench` runs them and compares the results with bench/baseline.json (see compare.py).
+// The baseline is machine specific: `make microbench-baseline` records it, on the idle benchmark machine, when the
+// machine or the benchmarks change. compare.py rejects runs made with a debug build of google benchmark.
+
+#include "lib/Deal.h"
+#include "lib/Distribution.h"
+#include "lib/GameState.h"
+#include "lib/KnowableState.h"
+#include "lib/PossibilityAnalyzer.h"
+#include "lib/RandomStrategy.h"
+#include "lib/combinatorics.h"
+#include "lib/random.h"
+
+#include <benchmark/benchmark.h>
+
+const uint64_t kSeed = 1;
+static const char* kDealIndex = "9a100f10507bdecf4d3bded7";
+
+static GameState position(int playNumber)
+{
+    GameState state{Deal(parseHex128(kDealIndex))};
+    while (state.PlayNumber() < unsigned(playNumber))
+    {
+        const CardHand choices = state.LegalPlays();
+        state.PlayCard(choices.NthCard(state.PlayNumber() % choices.Size()));
+    }
+    assert(state.PointsPlayed() < 26);
+    return state;
+}
+
+static void positions(benchmark::internal::Benchmark* b)
+{
+    b->ArgName("play")->Arg(6)->Arg(22)->Arg(38);
+}
+
+static void BM_LegalPlays(benchmark::State& bm)
+{
+    const GameState state = position(bm.range(0));
+    for (auto _ : bm)
+        benchmark::DoNotOptimize(state.LegalPlays());
+}
+BENCHMARK(BM_LegalPlays)->Apply(positions);
+
+static void BM_PlayCard(benchmark::State& bm)
+{
+    // Includes copying the GameState, as MonteCarlo does for every rollout.
+    const GameState state = position(bm.range(0));
+    const Card card = state.LegalPlays().FirstCard();
+    for (auto _ : bm)
+    {
+        GameState next(state);
+        next.PlayCard(card);
+        benchmark::DoNotOptimize(next);
+    }
+}
+BENCHMARK(BM_PlayCard)->Apply(positions);
+
+static void BM_PlayOutGameMonteCarlo(benchmark::State& bm)
+{
+    const GameState state = position(bm.range(0));
+    const StrategyPtr random(new RandomStrategy());
+    const RandomGenerator rng(kSeed);
+    for (auto _ : bm)
+    {
+        GameState next(state);
+        benchmark::DoNotOptimize(next.PlayOutGameMonteCarlo(random, rng));
+    }
+}
+BENCHMARK(BM_PlayOutGameMonteCarlo)->Apply(positions);
+
+static void BM_Analyze(benchmark::State& bm)
+{
+    const KnowableState knowable(position(bm.range(0)));
+    for (auto _ : bm)
+    {
+        PossibilityAnalyzer* analyzer = knowable.Analyze();
+        benchmark::DoNotOptimize(analyzer);
+        delete analyzer;
+    }
+}
+BENCHMARK(BM_Analyze)->Apply(positions);
+
+static void BM_ActualizePossibility(benchmark::State& bm)
+{
+    const KnowableState knowable(position(bm.range(0)));
+    PossibilityAnalyzer* analyzer = knowable.Analyze();
+    const uint128_t possibilities = analyzer->Possibilities();
+    CardHands prepared;
+    knowable.PrepareHands(prepared);
+    const RandomGenerator rng(kSeed);
+    for (auto _ : bm)
+    {
+        CardHands hands(prepared);
+        analyzer->ActualizePossibility(rng.range128(possibilities), hands);
+        benchmark::DoNotOptimize(hands);
+    }
+    delete analyzer;
+}
+BENCHMARK(BM_ActualizePossibility)->Apply(positions);
+
+static void BM_DealUnknownsToHands(benchmark::State& bm)
+{
+    const KnowableState knowable(position(bm.range(0)));
+    const CardDeck unknowns = knowable.UnknownCardsForCurrentPlayer();
+    CardHands prepared;
+    knowable.PrepareHands(prepared);
+    const uint128_t possibilities = PossibleDealUnknownsToHands(unknowns, prepared);
+    const RandomGenerator rng(kSeed);
+    for (auto _ : bm)
+    {
+        CardHands hands(prepared);
+        DealUnknownsToHands(unknowns, hands, rng.range128(possibilities));
+        benchmark::DoNotOptimize(hands);
+    }
+}
+BENCHMARK(BM_DealUnknownsToHands)->Apply(positions);
+
+static void BM_combinations128(benchmark::State& bm)
+{
+    unsigned n = bm.range(0);
+    unsigned k = bm.range(1);
+    for (auto _ : bm)
+    {
+        benchmark::DoNotOptimize(n);
+        benchmark::DoNotOptimize(combinations128(n, k));
+    }
+}
+BENCHMARK(BM_combinations128)->ArgNames({"n", "k"})->Args({13, 4})->Args({26, 13})->Args({52, 13});
+
+static void BM_AsFloatMatrix(benchmark::State& bm)
+{
+    const KnowableState knowable(position(bm.range(0)));
+    for (auto _ : bm)
+        benchmark::DoNotOptimize(knowable.AsFloatMatrix());
+}
+BENCHMARK(BM_AsFloatMatrix)->Apply(positions);
+
+static void BM_ExpectedDistribution(benchmark::State& bm)
+{
+    const KnowableState knowable(position(bm.range(0)));
+    PossibilityAnalyzer* analyzer = knowable.Analyze();
+    CardHands prepared;
+    knowable.PrepareHands(prepared);
+    for (auto _ : bm)
+    {
+        Distribution distribution;
+        CardHands hands(prepared);
+        analyzer->ExpectedDistribution(distribution, hands);
+        benchmark::DoNotOptimize(distribution);
+    }
+    delete analyzer;
+}
+BENCHMARK(BM_ExpectedDistribution)->Apply(positions);
+
+static void BM_range128(benchmark::State& bm, uint128_t range)
+{
+    const RandomGenerator rng(kSeed);
+    for (auto _ : bm)
+        benchmark::DoNotOptimize(rng.range128(range));
+}
+BENCHMARK_CAPTURE(BM_range128, deals, possibleDistinguishableDeals());
+BENCHMARK_CAPTURE(BM_range128, small, uint128_t(1000));
+
+BENCHMARK_MAIN();
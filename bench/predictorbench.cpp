@@ -0,0 +1,329 @@
+// bench/predictorbench.cpp
+// Inference throughput and latency of the Predictor implementations, for choosing predictor settings per machine.
+//
+// Loads a SavedModel, then for every combination of predictor, producer thread count and (for batching predictors)
+// batch size, runs a fixed number of predictions from each of K producer threads, each thread calling Predict as
+// DnnModelIntuition does: one position per call, the next call as soon as the last returns. The inputs are
+// synthetic positions reached by random play from seeded deals. For each configuration it reports throughput,
+// latency percentiles, and for batching predictors the histogram of batch sizes actually run.
+//
+// To benchmark a new Predictor, add it to kPredictors.
+
+#include "lib/Deal.h"
+#include "lib/GameState.h"
+#include "lib/KnowableState.h"
+#include "lib/Predictor.h"
+#include "lib/RandomStrategy.h"
+#include "lib/random.h"
+#include "lib/timer.h"
+
+#include <tensorflow/cc/saved_model/loader.h>
+#include <tensorflow/cc/saved_model/tag_constants.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <functional>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+using tensorflow::SavedModelBundle;
+using tensorflow::Tensor;
+
+struct PredictorKind
+{
+    const char* name;
+    bool batching;
+    // Whether batchSize and batchWaitMillis mean anything to it. Others run once per configuration of threads.
+    std::function<Predictor*(const SavedModelBundle& model, unsigned batchSize, unsigned long batchWaitMillis)> make;
+};
+
+const PredictorKind kPredictors[] = {
+    {"sync", false,
+        [](const SavedModelBundle& model, unsigned, unsigned long) { return new SynchronousPredictor(model); }},
+    {"pooled", true,
+        [](const SavedModelBundle& model, unsigned batchSize, unsigned long batchWaitMillis) {
+            return new PooledPredictor(model, {}, batchSize, batchWaitMillis);
+        }},
+};
+
+std::string gModelPath;
+std::vector<std::string> gPredictorNames = {"sync", "pooled"};
+std::vector<unsigned> gThreadCounts = {1, 2, 4, 8};
+std::vector<unsigned> gBatchSizes = {1, 4, 8, 16};
+unsigned long gBatchWaitMillis = 1;
+unsigned gRequests = 2000;
+unsigned gPositions = 1024;
+uint64_t gSeed = 1;
+
+void usage()
+{
+    const char* lines[] = {"Usage: predictorbench [options...] <modelDir>",
+        "  Options:", "    -p,--predictors <list>     comma separated predictors to run (default:sync,pooled)",
+        "    -t,--threads <list>        comma separated producer thread counts (default:1,2,4,8)",
+        "    -b,--batch-sizes <list>    comma separated batch sizes for batching predictors (default:1,4,8,16)",
+        "    -w,--batch-wait <ms>       how long a batching predictor waits to fill a batch (default:1)",
+        "    -n,--requests <int>        predictions per producer thread per configuration (default:2000)",
+        "    -s,--positions <int>       the number of distinct synthetic positions (default:1024)",
+        "    --seed <int>               the seed for the synthetic positions (default:1)",
+        "    -h,--help                  print this message", 0};
+    for (int i = 0; lines[i] != 0; ++i)
+        printf("%s\n", lines[i]);
+    exit(0);
+}
+
+std::vector<std::string> splitList(const char* arg)
+{
+    std::vector<std::string> items;
+    std::string item;
+    for (const char* p = arg;; ++p)
+    {
+        if (*p == ',' || *p == 0)
+        {
+            if (!item.empty())
+                items.push_back(item);
+            item.clear();
+            if (*p == 0)
+                break;
+        }
+        else
+            item += *p;
+    }
+    return items;
+}
+
+std::vector<unsigned> splitCounts(const char* arg)
+{
+    std::vector<unsigned> counts;
+    for (const std::string& item : splitList(arg))
+    {
+        int count = atoi(item.c_str());
+        if (count <= 0)
+            usage();
+        counts.push_back(count);
+    }
+    if (counts.empty())
+        usage();
+    return counts;
+}
+
+const PredictorKind* findPredictor(const std::string& name)
+{
+    for (const PredictorKind& kind : kPredictors)
+    {
+        if (name == kind.name)
+            return &kind;
+    }
+    return nullptr;
+}
+
+void parseArgs(int argc, char** argv)
+{
+    enum
+    {
+        kSeedOption = 'S' + 256,
+    };
+    const struct option longopts[] = {{"predictors", required_argument, NULL, 'p'},
+        {"threads", required_argument, NULL, 't'}, {"batch-sizes", required_argument, NULL, 'b'},
+        {"batch-wait", required_argument, NULL, 'w'}, {"requests", required_argument, NULL, 'n'},
+        {"positions", required_argument, NULL, 's'}, {"seed", required_argument, NULL, kSeedOption},
+        {"help", no_argument, NULL, 'h'}, {NULL, 0, NULL, 0}};
+
+    while (true)
+    {
+        int longindex = 0;
+        int ch = getopt_long(argc, argv, "p:t:b:w:n:s:h", longopts, &longindex);
+        if (ch == -1)
+            break;
+
+        switch (ch)
+        {
+        case 'p':
+            gPredictorNames = splitList(optarg);
+            break;
+        case 't':
+            gThreadCounts = splitCounts(optarg);
+            break;
+        case 'b':
+            gBatchSizes = splitCounts(optarg);
+            break;
+        case 'w':
+            gBatchWaitMillis = strtoul(optarg, 0, 10);
+            break;
+        case 'n':
+            gRequests = atoi(optarg);
+            break;
+        case 's':
+            gPositions = atoi(optarg);
+            break;
+        case kSeedOption:
+            gSeed = strtoull(optarg, 0, 10);
+            break;
+        case 'h':
+        default:
+            usage();
+            break;
+        }
+    }
+
+    if (optind + 1 != argc || gRequests <= 0 || gPositions <= 0 || gPredictorNames.empty())
+        usage();
+    gModelPath = argv[optind];
+
+    for (const std::string& name : gPredictorNames)
+    {
+        if (findPredictor(name) == nullptr)
+        {
+            fprintf(stderr, "Unknown predictor %s\n", name.c_str());
+            exit(1);
+        }
+    }
+}
+
+void loadModel(const std::string& path, SavedModelBundle& model)
+{
+    using namespace tensorflow;
+    SessionOptions session_options;
+    RunOptions run_options;
+    auto status = LoadSavedModel(session_options, run_options, path, {kSavedModelTagServe}, &model);
+    if (!status.ok())
+    {
+        std::cerr << "Failed: " << status;
+        exit(1);
+    }
+}
+
+// The input tensor of a position, made the same way as DnnModelIntuition::predictOutcomes makes it.
+Tensor inputTensor(const KnowableState& knowable)
+{
+    using namespace tensorflow;
+    FloatMatrix matrix = knowable.AsFloatMatrix();
+    Tensor mainData(DT_FLOAT, TensorShape({1, kCardsPerDeck, KnowableState::kNumFeaturesPerCard}));
+    memcpy(mainData.flat<float>().data(), matrix.data(), KnowableState::kNumFeatures * sizeof(float));
+    return mainData;
+}
+
+// Positions from all stages of the game, each reached by random play from a random deal.
+std::vector<Tensor> syntheticInputs(unsigned count, uint64_t seed)
+{
+    const RandomGenerator rng(seed);
+    const StrategyPtr random(new RandomStrategy());
+    std::vector<Tensor> inputs;
+    inputs.reserve(count);
+    while (inputs.size() < count)
+    {
+        GameState state{Deal(Deal::RandomDealIndex(rng))};
+        const unsigned playNumber = rng.range64(48);
+        while (state.PlayNumber() < playNumber && state.PointsPlayed() < 26)
+            state.NextPlay(random, rng);
+        if (state.PointsPlayed() < 26)
+            inputs.push_back(inputTensor(KnowableState(state)));
+    }
+    return inputs;
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    assert(!sorted.empty());
+    size_t i = size_t(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+void runConfiguration(const PredictorKind& kind, Predictor& predictor, unsigned threads, unsigned batchSize,
+    const std::vector<Tensor>& inputs)
+{
+    std::vector<std::vector<double>> latencies(threads);
+    std::vector<std::thread> producers;
+
+    const double start = now();
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        producers.emplace_back([&, t]() {
+            std::vector<double>& mine = latencies[t];
+            mine.reserve(gRequests);
+            for (unsigned i = 0; i < gRequests; ++i)
+            {
+                const Tensor& input = inputs[(size_t(t) * gRequests + i) % inputs.size()];
+                std::vector<Tensor> outputs;
+                const double requested = now();
+                predictor.Predict(input, outputs);
+                mine.push_back(delta(requested));
+            }
+        });
+    }
+    for (std::thread& producer : producers)
+        producer.join();
+    const double elapsed = delta(start);
+
+    std::vector<double> all;
+    for (const std::vector<double>& mine : latencies)
+        all.insert(all.end(), mine.begin(), mine.end());
+    std::sort(all.begin(), all.end());
+
+    char batch[16] = "-";
+    if (kind.batching)
+        snprintf(batch, sizeof(batch), "%u", batchSize);
+    printf("%-8s %7u %5s %9zu %10.1f %9.3f %9.3f %9.3f", kind.name, threads, batch, all.size(),
+        all.size() / elapsed, 1000.0 * percentile(all, 0.50), 1000.0 * percentile(all, 0.99), 1000.0 * all.back());
+
+    const PooledPredictor* pooled = dynamic_cast<const PooledPredictor*>(&predictor);
+    if (pooled != nullptr)
+    {
+        std::vector<uint64_t> counts = pooled->BatchSizeCounts();
+        uint64_t batches = 0, requests = 0;
+        for (size_t size = 0; size < counts.size(); ++size)
+        {
+            batches += counts[size];
+            requests += size * counts[size];
+        }
+        printf(" %10.2f  ", batches ? double(requests) / batches : 0.0);
+        for (size_t size = 0; size < counts.size(); ++size)
+        {
+            if (counts[size] != 0)
+                printf(" %zu:%lu", size, (unsigned long)counts[size]);
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+    parseArgs(argc, argv);
+
+    SavedModelBundle model;
+    loadModel(gModelPath, model);
+    const std::vector<Tensor> inputs = syntheticInputs(gPositions, gSeed);
+
+    // The first run of a session is much slower than the rest, so make it before measuring anything.
+    {
+        SynchronousPredictor warmup(model);
+        std::vector<Tensor> outputs;
+        warmup.Predict(inputs[0], outputs);
+    }
+
+    printf("%u predictions per thread, %u positions, batch wait %lums, %u hardware threads\n", gRequests,
+        gPositions, gBatchWaitMillis, std::thread::hardware_concurrency());
+    printf("%-8s %7s %5s %9s %10s %9s %9s %9s %10s  %s\n", "pred", "threads", "batch", "requests", "req/s",
+        "p50(ms)", "p99(ms)", "max(ms)", "mean-batch", "batch-size:count");
+
+    for (const std::string& name : gPredictorNames)
+    {
+        const PredictorKind& kind = *findPredictor(name);
+        const std::vector<unsigned> batchSizes = kind.batching ? gBatchSizes : std::vector<unsigned>{1};
+        for (unsigned batchSize : batchSizes)
+        {
+            for (unsigned threads : gThreadCounts)
+            {
+                // A new predictor for each configuration, so that its batch histogram covers only this one.
+                std::unique_ptr<Predictor> predictor(kind.make(model, batchSize, gBatchWaitMillis));
+                runConfiguration(kind, *predictor, threads, batchSize, inputs);
+            }
+        }
+    }
+    return 0;
+}
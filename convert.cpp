@@ -0,0 +1,259 @@
+// convert.cpp
+// Convert binary annotation files (written by WriteBinaryDataAnnotator) into the memmap datasets read by train.py.
+
+#include "lib/AnnotationRecord.h"
+#include "lib/KnowableState.h"
+
+#include "lib/random.h"
+#include "lib/timer.h"
+
+#include <dlib/threads.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <future>
+#include <string>
+#include <vector>
+
+const char* gOutDir = "dataset";
+bool gExact = false;
+bool gShuffle = true;
+
+void usage()
+{
+    const char* lines[] = {"Usage: convert [options...] <file.rec>...",
+        "  Options:", "    -o,--out <dir>             the dataset directory to write (default:dataset)",
+        "    -x,--exact                 use the recorded exact card probabilities instead of the approximate ones",
+        "    -n,--no-shuffle            keep records in input order (default: shuffle)",
+        "    -h,--help                  print this message", 0};
+    for (int i = 0; lines[i] != 0; ++i)
+        printf("%s\n", lines[i]);
+    exit(0);
+}
+
+void parseArgs(int argc, char** argv)
+{
+    const struct option longopts[] = {{"out", required_argument, NULL, 'o'}, {"exact", no_argument, NULL, 'x'},
+        {"no-shuffle", no_argument, NULL, 'n'}, {"help", no_argument, NULL, 'h'}, {NULL, 0, NULL, 0}};
+
+    while (true)
+    {
+        int longindex = 0;
+        int ch = getopt_long(argc, argv, "o:xnh", longopts, &longindex);
+        if (ch == -1)
+        {
+            break;
+        }
+
+        switch (ch)
+        {
+        case 'o':
+        {
+            gOutDir = optarg;
+            break;
+        }
+        case 'x':
+        {
+            gExact = true;
+            break;
+        }
+        case 'n':
+        {
+            gShuffle = false;
+            break;
+        }
+        case 'h':
+        default:
+        {
+            usage();
+            break;
+        }
+        }
+    }
+}
+
+void fail(const char* what, const std::string& path)
+{
+    fprintf(stderr, "%s %s failed: %s\n", what, path.c_str(), strerror(errno));
+    exit(1);
+}
+
+// A read-only mapping of one annotation file.
+struct InputFile
+{
+    const AnnotationRecord* records;
+    size_t numRecords;
+};
+
+InputFile mapInput(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        fail("open", path);
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        fail("fstat", path);
+
+    size_t size = st.st_size;
+    if (size < sizeof(AnnotationFileHeader))
+    {
+        fprintf(stderr, "%s is not an annotation file\n", path.c_str());
+        exit(1);
+    }
+
+    const char* base = (const char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED)
+        fail("mmap", path);
+    close(fd);
+
+    const AnnotationFileHeader* header = (const AnnotationFileHeader*) base;
+    if (!IsValidAnnotationFileHeader(*header))
+    {
+        fprintf(stderr, "%s has a bad header or an unsupported version\n", path.c_str());
+        exit(1);
+    }
+
+    // A trailing partial record means the writer was killed mid-write. Ignore it.
+    InputFile input;
+    input.records = (const AnnotationRecord*) (base + sizeof(AnnotationFileHeader));
+    input.numRecords = (size - sizeof(AnnotationFileHeader)) / sizeof(AnnotationRecord);
+    madvise((void*) base, size, MADV_WILLNEED);
+    return input;
+}
+
+// A writable float32 memmap of the given number of elements.
+float* mapOutput(const std::string& path, size_t numFloats)
+{
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+        fail("open", path);
+    size_t size = numFloats * sizeof(float);
+    if (ftruncate(fd, size) != 0)
+        fail("ftruncate", path);
+    float* data = (float*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+        fail("mmap", path);
+    close(fd);
+    return data;
+}
+
+struct Outputs
+{
+    float* main;   // N x 52 x 10
+    float* score;  // N x 52
+    float* trick;  // N x 52
+    float* moon;   // N x 52 x 3
+};
+
+void convertRecord(const AnnotationRecord& rec, size_t row, const Outputs& out)
+{
+    const KnowableState state(rec.state);
+
+    float* main = out.main + row * KnowableState::kNumFeatures;
+    float* score = out.score + row * kCardsPerDeck;
+    float* trick = out.trick + row * kCardsPerDeck;
+    float* moon = out.moon + row * kCardsPerDeck * 3;
+
+    FloatMatrix mainData = state.AsFloatMatrix();
+    if (gExact)
+    {
+        for (int p = 0; p < 4; p++)
+        {
+            int player = (state.CurrentPlayer() + p) % 4;
+            for (Card card = 0; card < kCardsPerDeck; card++)
+                mainData(card, eCardProbPlayer0 + p) = rec.prob[card][player];
+        }
+    }
+    memcpy(main, mainData.data(), KnowableState::kNumFeatures * sizeof(float));
+
+    const CardHand choices = state.LegalPlays();
+    assert(choices.Size() == rec.numChoices);
+
+    memset(score, 0, kCardsPerDeck * sizeof(float));
+    memset(trick, 0, kCardsPerDeck * sizeof(float));
+    memset(moon, 0, kCardsPerDeck * 3 * sizeof(float));
+    for (int i = 0; i < rec.numChoices; ++i)
+    {
+        Card card = rec.choices[i];
+        assert(choices.HasCard(card));
+        score[card] = rec.expectedScore[i];
+        trick[card] = rec.winsTrickProb[i];
+        for (int j = 0; j < 3; ++j)
+            moon[card * 3 + j] = rec.moonProb[i][j];
+    }
+}
+
+int main(int argc, char** argv)
+{
+    parseArgs(argc, argv);
+    if (optind == argc)
+        usage();
+
+    // Index every record of every input file.
+    std::vector<const AnnotationRecord*> records;
+    for (int i = optind; i < argc; ++i)
+    {
+        InputFile input = mapInput(argv[i]);
+        for (size_t r = 0; r < input.numRecords; ++r)
+            records.push_back(input.records + r);
+    }
+    const size_t kNumRecords = records.size();
+    printf("Converting %zu records from %d files\n", kNumRecords, argc - optind);
+    if (kNumRecords == 0)
+        return 0;
+
+    if (gShuffle)
+    {
+        // Fisher-Yates
+        for (size_t i = kNumRecords - 1; i > 0; --i)
+            std::swap(records[i], records[RandomGenerator::Range64(i + 1)]);
+    }
+
+    int err = mkdir(gOutDir, 0777);
+    if (err != 0 && errno != EEXIST)
+        fail("mkdir", gOutDir);
+
+    const std::string dir(gOutDir);
+    Outputs out;
+    out.main = mapOutput(dir + "/main_data.np.mmap", kNumRecords * KnowableState::kNumFeatures);
+    out.score = mapOutput(dir + "/score_data.np.mmap", kNumRecords * kCardsPerDeck);
+    out.trick = mapOutput(dir + "/trick_data.np.mmap", kNumRecords * kCardsPerDeck);
+    out.moon = mapOutput(dir + "/moon_data.np.mmap", kNumRecords * kCardsPerDeck * 3);
+
+    // Each task converts a contiguous range of output rows, so tasks never share a page except at the edges.
+    const int kConcurrency = std::max(1u, std::thread::hardware_concurrency());
+    const size_t kChunk = (kNumRecords + kConcurrency - 1) / kConcurrency;
+
+    const double startTime = now();
+    dlib::thread_pool tp(kConcurrency);
+    std::vector<std::future<int>> tasks(kConcurrency);
+    for (int t = 0; t < kConcurrency; ++t)
+    {
+        const size_t begin = std::min(kNumRecords, t * kChunk);
+        const size_t end = std::min(kNumRecords, begin + kChunk);
+        tasks[t] = dlib::async(tp, [begin, end, &records, &out]() -> int {
+            for (size_t row = begin; row < end; ++row)
+                convertRecord(*records[row], row, out);
+            return 0;
+        });
+    }
+    for (auto& task : tasks)
+        task.get();
+
+    msync(out.main, kNumRecords * KnowableState::kNumFeatures * sizeof(float), MS_SYNC);
+    msync(out.score, kNumRecords * kCardsPerDeck * sizeof(float), MS_SYNC);
+    msync(out.trick, kNumRecords * kCardsPerDeck * sizeof(float), MS_SYNC);
+    msync(out.moon, kNumRecords * kCardsPerDeck * 3 * sizeof(float), MS_SYNC);
+
+    const double seconds = now() - startTime;
+    printf("Wrote %zu records to %s in %4.2f seconds (%.0f records/sec)\n", kNumRecords, gOutDir, seconds,
+        kNumRecords / seconds);
+    return 0;
+}
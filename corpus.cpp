@@ -0,0 +1,128 @@
+// corpus.cpp
+// Generate, convert, print and split binary deal corpora (see lib/DealCorpus.h).
+
+#include "lib/DealCorpus.h"
+
+#include "lib/math.h"
+#include "lib/timer.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+uint64_t gSeed = 1;
+const char* gShardSpec = nullptr;
+
+void usage()
+{
+    const char* lines[] = {"Usage: corpus [options...] <command> <args...>", "  Commands:",
+        "    generate <count> <out>     write a corpus of count random deals, reproducible from the seed",
+        "    convert <in.txt> <out>     write a corpus of the hex deal indexes in a text file",
+        "    print <corpus>             print the deal indexes of a corpus (or shard), one hex index per line",
+        "    split <corpus> <n> <out>   write the n shards of a corpus to <out>.0 ... <out>.<n-1>",
+        "  Options:", "    -s,--seed <int>            the seed for generate (default:1)",
+        "    --shard <k>/<n>            print only the k-th of n equal slices of the corpus",
+        "    -h,--help                  print this message", 0};
+    for (int i = 0; lines[i] != 0; ++i)
+        printf("%s\n", lines[i]);
+    exit(0);
+}
+
+void parseArgs(int argc, char** argv)
+{
+    const struct option longopts[] = {{"seed", required_argument, NULL, 's'},
+        {"shard", required_argument, NULL, 'H'}, {"help", no_argument, NULL, 'h'}, {NULL, 0, NULL, 0}};
+
+    while (true)
+    {
+        int longindex = 0;
+        int ch = getopt_long(argc, argv, "s:h", longopts, &longindex);
+        if (ch == -1)
+        {
+            break;
+        }
+
+        switch (ch)
+        {
+        case 's':
+        {
+            gSeed = strtoull(optarg, 0, 10);
+            break;
+        }
+        case 'H':
+        {
+            gShardSpec = optarg;
+            break;
+        }
+        case 'h':
+        default:
+        {
+            usage();
+            break;
+        }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    parseArgs(argc, argv);
+    if (optind == argc)
+        usage();
+
+    const std::string command(argv[optind++]);
+    const int numArgs = argc - optind;
+    char** args = argv + optind;
+
+    if (command == "generate" && numArgs == 2)
+    {
+        const size_t count = strtoull(args[0], 0, 10);
+        const double startTime = now();
+        DealCorpus::Generate(args[1], count, gSeed);
+        printf("Wrote %zu deals with seed %llu to %s in %4.2f seconds\n", count, (unsigned long long) gSeed, args[1],
+            now() - startTime);
+    }
+    else if (command == "convert" && numArgs == 2)
+    {
+        const DealCorpus text(args[0]);
+        DealCorpus::Write(args[1], text.Deals(), text.Size());
+        printf("Wrote %zu deals to %s\n", text.Size(), args[1]);
+    }
+    else if (command == "print" && numArgs == 1)
+    {
+        const DealCorpus corpus(args[0]);
+        size_t begin = 0;
+        size_t end = corpus.Size();
+        if (gShardSpec != nullptr)
+        {
+            int shard, numShards;
+            if (!DealCorpus::ParseShard(gShardSpec, shard, numShards))
+                usage();
+            DealCorpus::ShardRange(corpus.Size(), shard, numShards, begin, end);
+        }
+        for (size_t i = begin; i < end; ++i)
+            printf("%s\n", asHexString(corpus[i]).c_str());
+    }
+    else if (command == "split" && numArgs == 3)
+    {
+        const DealCorpus corpus(args[0]);
+        const int numShards = atoi(args[1]);
+        if (numShards <= 0)
+            usage();
+        for (int shard = 0; shard < numShards; ++shard)
+        {
+            size_t begin, end;
+            DealCorpus::ShardRange(corpus.Size(), shard, numShards, begin, end);
+            const std::string path = std::string(args[2]) + "." + std::to_string(shard);
+            DealCorpus::Write(path, corpus.Deals() + begin, end - begin, corpus.Seed());
+            printf("Wrote deals %zu to %zu to %s\n", begin, end, path.c_str());
+        }
+    }
+    else
+    {
+        usage();
+    }
+    return 0;
+}
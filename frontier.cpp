@@ -0,0 +1,281 @@
+// frontier.cpp
+// Measures the strength and the cost of strategy configurations, and finds the ones worth their cost.
+//
+// Every strategy plays the same corpus of deals against one reference opponent, a match (six games) per deal as in
+// tournament, with the same game seeds, so their scores differ by the strategies and not by the luck of the deal.
+// Strength is the mean Scores::ChampionAdvantage() over the matches (points per game fewer than the opponent), with
+// a 95% confidence interval. Cost is the CPU time per decision, measured separately by having the strategy choose a
+// play in each of a fixed set of positions, one at a time, so that the process CPU time spent during the decision is
+// all the strategy's own (including any threads it uses). Wall time per decision is reported too.
+//
+// A configuration is on the Pareto frontier when no other is at least as strong for less CPU time.
+
+#include "lib/Deal.h"
+#include "lib/DealCorpus.h"
+#include "lib/GameState.h"
+#include "lib/KnowableState.h"
+#include "lib/RandomStrategy.h"
+#include "lib/Tournament.h"
+
+#include "lib/math.h"
+#include "lib/random.h"
+#include "lib/timer.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+const char* gOpponentStr = "random";
+int gNumDeals = 20;
+const char* gDealsPath = nullptr;
+int gNumPositions = 50;
+uint64_t gSeed = 1;
+int gJobs = std::max(1u, std::thread::hardware_concurrency());
+const char* gResultsPath = nullptr;
+
+void usage()
+{
+    const char* lines[] = {"Usage: frontier [options...] <strategy> <strategy>...",
+        "  Each strategy is a spec as for tournament, e.g. random, random#100 or <model>#30.", "  Options:",
+        "    -o,--opponent <strategy>   the reference opponent every strategy plays (default:random)",
+        "    -g,--games <int>           the number of deals to generate, one match each (default:20)",
+        "    -d,--deals <dealIndexFile> play the deals in this corpus (or text file) instead of generating them",
+        "    -p,--positions <int>       the number of positions each strategy is timed on (default:50)",
+        "    -s,--seed <int>            the seed for the generated deals, the positions and every game (default:1)",
+        "    -j,--jobs <int>            the number of worker threads for the matches (default: one per core)",
+        "    -r,--results <path>        also write the results to this file, one tab separated line per strategy",
+        "    -h,--help                  print this message", 0};
+    for (int i = 0; lines[i] != 0; ++i)
+        printf("%s\n", lines[i]);
+    exit(0);
+}
+
+void parseArgs(int argc, char** argv)
+{
+    const struct option longopts[] = {{"opponent", required_argument, NULL, 'o'},
+        {"games", required_argument, NULL, 'g'}, {"deals", required_argument, NULL, 'd'},
+        {"positions", required_argument, NULL, 'p'}, {"seed", required_argument, NULL, 's'},
+        {"jobs", required_argument, NULL, 'j'}, {"results", required_argument, NULL, 'r'},
+        {"help", no_argument, NULL, 'h'}, {NULL, 0, NULL, 0}};
+
+    while (true)
+    {
+        int longindex = 0;
+        int ch = getopt_long(argc, argv, "o:g:d:p:s:j:r:h", longopts, &longindex);
+        if (ch == -1)
+            break;
+
+        switch (ch)
+        {
+        case 'o':
+            gOpponentStr = optarg;
+            break;
+        case 'g':
+            gNumDeals = atoi(optarg);
+            break;
+        case 'd':
+            gDealsPath = optarg;
+            break;
+        case 'p':
+            gNumPositions = atoi(optarg);
+            break;
+        case 's':
+            gSeed = strtoull(optarg, 0, 10);
+            break;
+        case 'j':
+            gJobs = atoi(optarg);
+            break;
+        case 'r':
+            gResultsPath = optarg;
+            break;
+        case 'h':
+        default:
+            usage();
+            break;
+        }
+    }
+
+    if (optind >= argc || gNumDeals <= 0 || gNumPositions <= 0 || gJobs <= 0)
+        usage();
+}
+
+double cpuTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Positions with a choice to make, each reached by random play from one of the deals.
+std::vector<GameState> timingPositions(const std::vector<uint128_t>& deals, int count)
+{
+    const StrategyPtr random(new RandomStrategy());
+    std::vector<GameState> positions;
+    for (int i = 0; int(positions.size()) < count; ++i)
+    {
+        const RandomGenerator rng(gSeed, Tournament::GameStream(i, 0));
+        GameState state{Deal(deals[i % deals.size()])};
+        const unsigned playNumber = rng.range64(44);
+        while (!state.Done() && state.PlayNumber() < playNumber)
+            state.NextPlay(random, rng);
+        while (!state.Done() && state.PointsPlayed() < 26 && state.LegalPlays().Size() == 1)
+            state.NextPlay(random, rng);
+        if (!state.Done() && state.PointsPlayed() < 26)
+            positions.push_back(state);
+    }
+    return positions;
+}
+
+struct Configuration
+{
+    std::string spec;
+    double cpuPerDecision;
+    double wallPerDecision;
+    double advantage;
+    double interval;
+    // The half width of the 95% confidence interval of the advantage.
+    bool frontier;
+};
+
+void timeDecisions(const StrategyPtr& player, const std::vector<GameState>& positions, Configuration& config)
+{
+    const RandomGenerator rng(gSeed);
+
+    // The first decision may include one time setup, such as a model's first inference.
+    player->choosePlay(KnowableState(positions[0]), rng);
+
+    double cpu = 0.0, wall = 0.0;
+    for (const GameState& position : positions)
+    {
+        const KnowableState knowable(position);
+        const double cpuStart = cpuTime();
+        const double wallStart = now();
+        player->choosePlay(knowable, rng);
+        wall += delta(wallStart);
+        cpu += cpuTime() - cpuStart;
+    }
+    config.cpuPerDecision = cpu / positions.size();
+    config.wallPerDecision = wall / positions.size();
+}
+
+void playMatches(const StrategyPtr& player, const StrategyPtr& opponent, const std::vector<uint128_t>& deals,
+    Configuration& config)
+{
+    const bool kQuiet = true;
+    const bool kSaveMoonDeals = false;
+    Tournament tournament(player, opponent, kQuiet, kSaveMoonDeals);
+    tournament.runParallelTournament(deals.size(), deals.data(), gJobs, gSeed);
+
+    const std::vector<double>& advantages = tournament.matchAdvantages();
+    const int n = advantages.size();
+    double sum = 0.0, sumSquares = 0.0;
+    for (double a : advantages)
+    {
+        sum += a;
+        sumSquares += a * a;
+    }
+    const double mean = sum / n;
+    const double variance = n > 1 ? (sumSquares - n * mean * mean) / (n - 1) : 0.0;
+    config.advantage = mean;
+    config.interval = 1.96 * sqrt(std::max(0.0, variance) / n);
+}
+
+void markFrontier(std::vector<Configuration>& configs)
+{
+    std::vector<Configuration*> byCost;
+    for (Configuration& config : configs)
+        byCost.push_back(&config);
+    std::sort(byCost.begin(), byCost.end(), [](const Configuration* a, const Configuration* b) {
+        if (a->cpuPerDecision != b->cpuPerDecision)
+            return a->cpuPerDecision < b->cpuPerDecision;
+        return a->advantage > b->advantage;
+    });
+
+    double best = -INFINITY;
+    for (Configuration* config : byCost)
+    {
+        config->frontier = config->advantage > best;
+        best = std::max(best, config->advantage);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    parseArgs(argc, argv);
+
+    std::vector<uint128_t> deals;
+    if (gDealsPath != nullptr)
+    {
+        DealCorpus corpus(gDealsPath);
+        if (corpus.Size() == 0)
+        {
+            fprintf(stderr, "No deals in %s\n", gDealsPath);
+            exit(1);
+        }
+        deals.assign(corpus.Deals(), corpus.Deals() + corpus.Size());
+    }
+    else
+    {
+        const RandomGenerator rng(gSeed);
+        for (int i = 0; i < gNumDeals; ++i)
+            deals.push_back(Deal::RandomDealIndex(rng));
+    }
+
+    const StrategyPtr opponent = makePlayer(gOpponentStr);
+    const std::vector<GameState> positions = timingPositions(deals, gNumPositions);
+    printf("Reference opponent %s, %zu deals, %zu timing positions, seed %llu, %d jobs\n", gOpponentStr,
+        deals.size(), positions.size(), (unsigned long long) gSeed, gJobs);
+    printf("%-32s %12s %12s %10s %8s\n", "strategy", "cpu ms/move", "wall ms/move", "advantage", "95% CI");
+
+    std::vector<Configuration> configs;
+    for (int i = optind; i < argc; ++i)
+    {
+        Configuration config;
+        config.spec = argv[i];
+        const StrategyPtr player = makePlayer(config.spec);
+        timeDecisions(player, positions, config);
+        playMatches(player, opponent, deals, config);
+        configs.push_back(config);
+        printf("%-32s %12.3f %12.3f %10.3f %8.3f\n", config.spec.c_str(), 1000.0 * config.cpuPerDecision,
+            1000.0 * config.wallPerDecision, config.advantage, config.interval);
+        fflush(stdout);
+    }
+
+    markFrontier(configs);
+    std::vector<const Configuration*> frontier;
+    for (const Configuration& config : configs)
+    {
+        if (config.frontier)
+            frontier.push_back(&config);
+    }
+    std::sort(frontier.begin(), frontier.end(),
+        [](const Configuration* a, const Configuration* b) { return a->cpuPerDecision < b->cpuPerDecision; });
+
+    printf("\nPareto frontier, least CPU time first:\n");
+    for (const Configuration* config : frontier)
+        printf("  %-30s %10.3f ms/move %8.3f +/- %.3f\n", config->spec.c_str(), 1000.0 * config->cpuPerDecision,
+            config->advantage, config->interval);
+
+    if (gResultsPath != nullptr)
+    {
+        FILE* results = fopen(gResultsPath, "w");
+        if (results == nullptr)
+        {
+            fprintf(stderr, "fopen %s failed: %s\n", gResultsPath, strerror(errno));
+            exit(1);
+        }
+        fprintf(results, "strategy\tcpu_ms\twall_ms\tadvantage\tci95\tfrontier\n");
+        for (const Configuration& config : configs)
+            fprintf(results, "%s\t%.6f\t%.6f\t%.6f\t%.6f\t%d\n", config.spec.c_str(),
+                1000.0 * config.cpuPerDecision, 1000.0 * config.wallPerDecision, config.advantage, config.interval,
+                config.frontier ? 1 : 0);
+        fclose(results);
+    }
+    return 0;
+}
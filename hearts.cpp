@@ -1,6 +1,12 @@
+#include "lib/DealCorpus.h"
 #include "lib/GameState.h"
+#include "lib/Metrics.h"
 #include "lib/MonteCarlo.h"
+#include "lib/Throughput.h"
+#include "lib/Trace.h"
+#include "lib/WriteBinaryDataAnnotator.h"
 #include "lib/WriteDataAnnotator.h"
+#include "lib/WriteReplayBuffer.h"
 #include "lib/WriteTrainingDataSets.h"
 
 #include "lib/math.h"
@@ -9,10 +15,34 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <getopt.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <thread>
 
-std::string gIntuitionName;
+std::string gIntuitionName = "random";
+std::string gAnnotatorName = "npy";
+int gTotalGames = 0;
+int gReportSeconds = 30;
+bool gAllSeats = false;
+double gRolloutSampleRate = 0.0;
+uint64_t gReplayCapacity = 1 << 20;
+ReplayBufferPtr gReplayBuffer;
+const char* gDealsPath = nullptr;
+DealCorpus* gCorpus = nullptr;
+uint64_t gSeed = 0;
+bool gBenchmark = false;
+const char* gBenchmarkPath = nullptr;
+const char* gMetricsPath = nullptr;
+double gMetricsInterval = 0.0;
+const char* gTracePath = nullptr;
+
+// The fixed workload of --benchmark, unless --games, --seed or --deals say otherwise.
+const int kBenchmarkGames = 64;
+const uint64_t kBenchmarkSeed = 1;
 
 volatile sig_atomic_t gRunning = 1;
 void trapCtrlC(int sig)
@@ -22,83 +52,286 @@ void trapCtrlC(int sig)
 }
 
 const int kConcurrency = 2 + (std::thread::hardware_concurrency() / 2);
-const int kIterationsPerTask = 100;
-const int kBatchSize = kConcurrency * kIterationsPerTask;
 dlib::thread_pool tp(kConcurrency);
 
-float run_iterations_task(int kIterationsPerTask, StrategyPtr opponent)
+// The work queue. Each game is one job, identified by its sequence number.
+// Workers claim the next job with an atomic increment, so there is no batch barrier: a worker that finishes a
+// short game immediately starts another while other workers are still busy with long ones.
+std::atomic<int> gNextGame(0);
+std::atomic<int> gGamesDone(0);
+std::atomic<int> gActiveWorkers(0);
+
+dlib::mutex gScoreMutex;
+double gTotalChampScore = 0.0;
+
+void usage()
 {
-    const RandomGenerator& rng = RandomGenerator::ThreadSpecific();
-    const uint32_t kNumAlternates = gIntuitionName != "random" ? 100 : 5000;
+    const char* lines[] = {"Usage: hearts [options...] [<games> [<intuition>]]",
+        "  Options:", "    -g,--games <int>           the number of games to play, 0 to play until ^C (default:kConcurrency)",
+        "    -i,--intuition <name>      the intuition used for rollouts and by the opponents (default:random)",
+        "    -a,--annotator <kind>      the training data format, one of npy, text, binary or replay:<path>",
+        "                               (default:npy)",
+        "    -c,--capacity <int>        the capacity when creating a replay:<path> buffer (default:1048576)",
+        "    -r,--report <seconds>      seconds between progress reports (default:30)",
+        "    -4,--all-seats             all four seats run monte carlo and write data (default: one seat)",
+        "    -s,--rollout-samples <p>   also write one position from each rollout with probability p (default:0);",
+        "                               only the npy annotator writes them",
+        "    -d,--deals <corpus>        play the deals of this corpus, in order and repeating (default: random deals)",
+        "    --seed <int>               seed each game's generator from (seed, game number), so that the games",
+        "                               played are the same for any number of threads (default: random)",
+        "    --benchmark[=<path>]       play a fixed workload (64 games, seed 1) and write its throughput as JSON",
+        "                               to path, or to stdout instead of the progress reports",
+        "    --metrics <path>           append metrics snapshots to path (default: stderr); a snapshot is written",
+        "                               whenever the process receives SIGUSR1",
+        "    --metrics-interval <secs>  also write a metrics snapshot every secs seconds (default: only on SIGUSR1)",
+        "    --trace <path>             write a Chrome trace (for chrome://tracing or ui.perfetto.dev) of where",
+        "                               every thread spends its time to path at exit",
+        "    -h,--help                  print this message", 0};
+    for (int i = 0; lines[i] != 0; ++i)
+        printf("%s\n", lines[i]);
+    exit(0);
+}
 
-    // The `player` uses monte carlo and will generate data
-    // AnnotatorPtr annotator(new WriteDataAnnotator());
-    AnnotatorPtr annotator(new WriteTrainingDataSets());
-    StrategyPtr player(new MonteCarlo(opponent, kNumAlternates, false, annotator));
+void parseArgs(int argc, char** argv)
+{
+    const struct option longopts[] = {{"games", required_argument, NULL, 'g'},
+        {"intuition", required_argument, NULL, 'i'}, {"annotator", required_argument, NULL, 'a'},
+        {"report", required_argument, NULL, 'r'}, {"all-seats", no_argument, NULL, '4'},
+        {"rollout-samples", required_argument, NULL, 's'},
+        {"capacity", required_argument, NULL, 'c'}, {"deals", required_argument, NULL, 'd'},
+        {"seed", required_argument, NULL, 'S'}, {"benchmark", optional_argument, NULL, 'B'},
+        {"metrics", required_argument, NULL, 'M'}, {"metrics-interval", required_argument, NULL, 'I'},
+        {"trace", required_argument, NULL, 'T'},
+        {"help", no_argument, NULL, 'h'}, {NULL, 0, NULL, 0}};
 
-    StrategyPtr players[4];
+    gTotalGames = -1;
 
-    float totalChampScore = 0.0;
-    for (int i = 0; i < kIterationsPerTask; ++i)
+    while (true)
     {
-        // It doesn't matter too much if we randomize seating because the two of clubs will still be dealt to a random
-        // seat at the table. But we randomize here to flush out any bugs in the logic for how the knowable state
-        // is serialized -- we don't want the current player to always be player 0.
-        int p = i % 4;
-        players[0] = players[1] = players[2] = players[3] = opponent;
-        players[p] = player;
+        int longindex = 0;
+        int ch = getopt_long(argc, argv, "g:i:a:r:4s:c:d:h", longopts, &longindex);
+        if (ch == -1)
+        {
+            break;
+        }
 
-        GameState state;
-        GameOutcome outcome = state.PlayGame(players, rng);
-        totalChampScore += outcome.ZeroMeanStandardScore(p);
+        switch (ch)
+        {
+        case 'g':
+        {
+            gTotalGames = atoi(optarg);
+            break;
+        }
+        case 'i':
+        {
+            gIntuitionName = optarg;
+            break;
+        }
+        case 'a':
+        {
+            gAnnotatorName = optarg;
+            break;
+        }
+        case 'r':
+        {
+            gReportSeconds = atoi(optarg);
+            break;
+        }
+        case '4':
+        {
+            gAllSeats = true;
+            break;
+        }
+        case 's':
+        {
+            gRolloutSampleRate = atof(optarg);
+            break;
+        }
+        case 'c':
+        {
+            gReplayCapacity = strtoull(optarg, 0, 10);
+            break;
+        }
+        case 'd':
+        {
+            gDealsPath = optarg;
+            break;
+        }
+        case 'S':
+        {
+            gSeed = strtoull(optarg, 0, 10);
+            if (gSeed == 0)
+                usage();
+            break;
+        }
+        case 'B':
+        {
+            gBenchmark = true;
+            gBenchmarkPath = optarg;
+            break;
+        }
+        case 'M':
+        {
+            gMetricsPath = optarg;
+            break;
+        }
+        case 'I':
+        {
+            gMetricsInterval = atof(optarg);
+            break;
+        }
+        case 'T':
+        {
+            gTracePath = optarg;
+            break;
+        }
+        case 'h':
+        default:
+        {
+            usage();
+            break;
+        }
+        }
     }
 
-    return totalChampScore;
+    // The original positional form: hearts <games> <intuition>
+    if (optind < argc)
+        gTotalGames = atoi(argv[optind++]);
+    if (optind < argc)
+        gIntuitionName = argv[optind++];
+    if (optind < argc)
+        usage();
+
+    if (gTotalGames < 0)
+        gTotalGames = gBenchmark ? kBenchmarkGames : kConcurrency;
+    if (gBenchmark && gSeed == 0)
+        gSeed = kBenchmarkSeed;
+
+    if (gReportSeconds <= 0 || gMetricsInterval < 0.0 || gRolloutSampleRate < 0.0 || gRolloutSampleRate > 1.0)
+        usage();
+    if (gBenchmark && gTotalGames == 0)
+        usage();
+
+    // Only WriteTrainingDataSets implements OnRolloutSample; the other annotators would drop the samples.
+    if (gRolloutSampleRate > 0.0 && gAnnotatorName != "npy")
+    {
+        fprintf(stderr, "--rollout-samples needs the npy annotator, not %s\n", gAnnotatorName.c_str());
+        exit(1);
+    }
 }
 
-void run(int iterations, const StrategyPtr& opponent)
+AnnotatorPtr makeAnnotator()
 {
-    assert((iterations % kConcurrency) == 0);
-    const double startTime = now();
+    if (gAnnotatorName == "npy")
+        return AnnotatorPtr(new WriteTrainingDataSets());
+    if (gAnnotatorName == "text")
+        return AnnotatorPtr(new WriteDataAnnotator());
+    if (gAnnotatorName == "binary")
+        return AnnotatorPtr(new WriteBinaryDataAnnotator());
+    if (gReplayBuffer)
+        return AnnotatorPtr(new WriteReplayBuffer(gReplayBuffer));
+    fprintf(stderr, "Unknown annotator %s\n", gAnnotatorName.c_str());
+    exit(1);
+}
 
-    std::vector<std::future<float>> totals(kConcurrency);
+// Plays game number `game`. With a seed, the game's deal (unless a corpus gives it) and every random choice in it
+// come from the game's own generator, so each game is the same whichever worker plays it.
+GameOutcome playGame(int game, StrategyPtr players[4])
+{
+    const RandomGenerator seeded(gSeed, game);
+    const RandomGenerator& rng = gSeed != 0 ? seeded : RandomGenerator::ThreadSpecific();
+    const uint128_t dealIndex = gCorpus != nullptr ? (*gCorpus)[game % gCorpus->Size()] : Deal::RandomDealIndex(rng);
+    GameState state{Deal(dealIndex)};
+    return state.PlayGame(players, rng);
+}
 
-    const int perTask = iterations / kConcurrency;
-    assert(perTask >= 1);
-    for (int i = 0; i < kConcurrency; i++)
-        totals[i] = dlib::async(tp, [perTask, opponent]() { return run_iterations_task(perTask, opponent); });
+// Claims the next game from the queue, or returns false when there is no more work.
+bool claimGame(int& game)
+{
+    if (!gRunning)
+        return false;
+    game = gNextGame++;
+    return gTotalGames == 0 || game < gTotalGames;
+}
 
-    float totalChampScore = 0;
-    for (int i = 0; i < kConcurrency; i++)
-        totalChampScore += totals[i].get();
+int run_worker(StrategyPtr opponent)
+{
+    const uint32_t kNumAlternates = gIntuitionName != "random" ? 100 : 5000;
 
-    printf("Average champion score: %3.1f\n", totalChampScore / iterations);
+    // The `player` uses monte carlo and will generate data.
+    // It and its annotator live as long as the worker, so the output files are opened once per worker.
+    AnnotatorPtr annotator = makeAnnotator();
+    MonteCarlo* monteCarlo = new MonteCarlo(opponent, kNumAlternates, false, annotator);
+    monteCarlo->SetRolloutSampleRate(gRolloutSampleRate);
+    StrategyPtr player(monteCarlo);
 
-    const double elapsed = now() - startTime;
-    const double avgTimePerRun = elapsed / iterations;
-    printf("Batch Elapsed time: %4.2f, Avg per iteration: %4.3f\n", elapsed, avgTimePerRun);
+    StrategyPtr players[4];
+
+    int played = 0;
+    int game;
+    while (claimGame(game))
+    {
+        // It doesn't matter too much if we randomize seating because the two of clubs will still be dealt to a random
+        // seat at the table. But we randomize here to flush out any bugs in the logic for how the knowable state
+        // is serialized -- we don't want the current player to always be player 0.
+        int p = game % 4;
+        if (gAllSeats)
+        {
+            // One MonteCarlo instance sits in every seat, so every decision in the game is labelled.
+            // Its rollouts run on this worker's thread, interleaved on the cores with those of the other workers'
+            // games, so there is no per-seat setup cost and no idle seat.
+            players[0] = players[1] = players[2] = players[3] = player;
+        }
+        else
+        {
+            players[0] = players[1] = players[2] = players[3] = opponent;
+            players[p] = player;
+        }
+
+        GameOutcome outcome = playGame(game, players);
+        {
+            dlib::auto_mutex lock(gScoreMutex);
+            gTotalChampScore += outcome.ZeroMeanStandardScore(p);
+        }
+        ++gGamesDone;
+        ++played;
+    }
+
+    --gActiveWorkers;
+    return played;
 }
 
-int roundUpToConcurrency(int i)
+void report(double startTime)
 {
-    assert(i > 0);
-    const int perTask = (i + kConcurrency - 1) / kConcurrency;
-    assert(perTask > 0);
-    return perTask * kConcurrency;
+    const int done = gGamesDone;
+    double totalChampScore;
+    {
+        dlib::auto_mutex lock(gScoreMutex);
+        totalChampScore = gTotalChampScore;
+    }
+
+    const double elapsed = now() - startTime;
+    if (gAllSeats)
+        printf("Games: %d\n", done); // the champion plays against itself, so its average score is always zero
+    else
+        printf("Games: %d, Average champion score: %3.1f\n", done, done ? totalChampScore / done : 0.0);
+    printf("Total Elapsed time: %4.2f, Avg per game: %4.3f, Games/sec: %4.2f\n", elapsed, done ? elapsed / done : 0.0,
+        done / elapsed);
+    if (gTotalGames != 0 && done != 0)
+    {
+        const double estimateRemaining = (gTotalGames - done) * elapsed / done;
+        printf("Estimated time remaining: %4.2f %4.2fh\n", estimateRemaining, estimateRemaining / 3600.0);
+    }
+    printf("\n");
+    fflush(stdout);
 }
 
 int main(int argc, char** argv)
 {
-    const int kTotalIterations = argc >= 2 ? roundUpToConcurrency(atoi(argv[1])) : kConcurrency;
-    assert(kTotalIterations >= kConcurrency);
-    assert((kTotalIterations % kConcurrency) == 0);
+    parseArgs(argc, argv);
 
-    const bool kUseDNN = argc >= 3;
-    gIntuitionName = kUseDNN ? argv[2] : "random";
     StrategyPtr intuition = makePlayer(gIntuitionName);
 
-    int remainingIterations = kTotalIterations;
-
     // Each of the three opponents will use intuition only and not write data.
     StrategyPtr opponent = intuition;
 
@@ -111,25 +344,67 @@ int main(int argc, char** argv)
         assert(err != 0);
     }
 
+    // All workers (and any other hearts processes given the same path) append to one shared replay buffer.
+    const std::string kReplayPrefix("replay:");
+    if (gAnnotatorName.compare(0, kReplayPrefix.size(), kReplayPrefix) == 0)
+    {
+        gReplayBuffer.reset(new ReplayBuffer(gAnnotatorName.substr(kReplayPrefix.size()), gReplayCapacity));
+        printf("Replay buffer holds %llu of %llu samples\n", (unsigned long long) gReplayBuffer->Size(),
+            (unsigned long long) gReplayBuffer->Capacity());
+    }
+
+    if (gDealsPath != nullptr)
+        gCorpus = new DealCorpus(gDealsPath);
+
     signal(SIGINT, trapCtrlC);
+    StartMetricsReporter(gMetricsPath, gMetricsInterval);
+    if (gTracePath != nullptr)
+        StartTracing(gTracePath);
+
+    ThroughputReport benchmark("hearts");
+    if (gBenchmark)
+    {
+        benchmark.Config("intuition", gIntuitionName);
+        benchmark.Config("annotator", gAnnotatorName);
+        benchmark.Config("all_seats", gAllSeats);
+        benchmark.Config("games", gTotalGames);
+        benchmark.Config("seed", gSeed);
+        benchmark.Config("deals", gDealsPath != nullptr ? gDealsPath : "seeded");
+        benchmark.Config("threads", kConcurrency);
+        benchmark.Start();
+    }
 
     const double startTime = now();
-    int doneSoFar = 0;
-    while (gRunning && remainingIterations > 0)
+
+    const int kNumWorkers = gTotalGames == 0 ? kConcurrency : std::min(kConcurrency, gTotalGames);
+    gActiveWorkers = kNumWorkers;
+    std::vector<std::future<int>> workers(kNumWorkers);
+    for (int i = 0; i < kNumWorkers; i++)
+        workers[i] = dlib::async(tp, [opponent]() { return run_worker(opponent); });
+
+    // The main thread only reports progress; it never holds up the workers.
+    double lastReport = startTime;
+    while (gActiveWorkers > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (!gBenchmark && now() - lastReport >= gReportSeconds)
+        {
+            report(startTime);
+            lastReport = now();
+        }
+    }
+
+    // SIGINT only stops workers from claiming new games, so every game started is played to completion.
+    for (int i = 0; i < kNumWorkers; i++)
+        workers[i].get();
+
+    if (gBenchmark)
     {
-        int iterationsThisBatch = remainingIterations > kBatchSize ? kBatchSize : remainingIterations;
-        assert((iterationsThisBatch % kConcurrency) == 0);
-        run(iterationsThisBatch, opponent);
-        remainingIterations -= iterationsThisBatch;
-        doneSoFar += iterationsThisBatch;
-
-        const double elapsed = now() - startTime;
-        const double avgTimePerRun = elapsed / doneSoFar;
-        const double estimateRemaining = remainingIterations * avgTimePerRun;
-
-        printf("Total Elapsed time: %4.2f, Avg per iteration: %4.3f\n", elapsed, avgTimePerRun);
-        printf("Estimated time remaining: %4.2f %4.2fh\n\n", estimateRemaining, estimateRemaining / 3600.0);
+        benchmark.Finish(gGamesDone);
+        benchmark.Write(gBenchmarkPath);
+        return 0;
     }
 
+    report(startTime);
     return 0;
 }
@@ -0,0 +1,136 @@
+// league.cpp
+// Rate any number of strategies against each other, playing only the matches missing from a persistent store.
+
+#include "lib/League.h"
+#include "lib/Deal.h"
+#include "lib/DealCorpus.h"
+
+#include "lib/math.h"
+#include "lib/random.h"
+#include "lib/timer.h"
+
+#include <getopt.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+int gNumDeals = 20;
+const char* gDealsPath = nullptr;
+const char* gStorePath = "league.tsv";
+uint64_t gSeed = 1;
+int gJobs = std::max(1u, std::thread::hardware_concurrency());
+bool gQuiet = false;
+
+void usage()
+{
+    const char* lines[] = {"Usage: league [options...] <strategy> <strategy>...",
+        "  Each strategy is a spec as for tournament, e.g. random, random#100 or <model>#30.", "  Options:",
+        "    -g,--games <int>           the number of deals in the corpus (default:20)",
+        "    -d,--deals <dealIndexFile> play the deals in this corpus (or text file) instead of generating them",
+        "    -s,--seed <int>            the seed for the generated deals and for every game (default:1)",
+        "    -r,--results <path>        the results store to read and append to (default:league.tsv)",
+        "    -j,--jobs <int>            the number of worker threads (default: one per core)",
+        "    -q,--quiet                 only print the ratings",
+        "    -h,--help                  print this message",
+        "  Every league sharing a results store should use the same deals and seed, so that a strategy's matches",
+        "  against every opponent are played on the same deals.", 0};
+    for (int i = 0; lines[i] != 0; ++i)
+        printf("%s\n", lines[i]);
+    exit(0);
+}
+
+void parseArgs(int argc, char** argv)
+{
+    const struct option longopts[] = {{"games", required_argument, NULL, 'g'},
+        {"deals", required_argument, NULL, 'd'}, {"seed", required_argument, NULL, 's'},
+        {"results", required_argument, NULL, 'r'}, {"jobs", required_argument, NULL, 'j'},
+        {"quiet", no_argument, NULL, 'q'}, {"help", no_argument, NULL, 'h'}, {NULL, 0, NULL, 0}};
+
+    while (true)
+    {
+        int longindex = 0;
+        int ch = getopt_long(argc, argv, "g:d:s:r:j:qh", longopts, &longindex);
+        if (ch == -1)
+        {
+            break;
+        }
+
+        switch (ch)
+        {
+        case 'g':
+        {
+            gNumDeals = atoi(optarg);
+            break;
+        }
+        case 'd':
+        {
+            gDealsPath = optarg;
+            break;
+        }
+        case 's':
+        {
+            gSeed = strtoull(optarg, 0, 10);
+            break;
+        }
+        case 'r':
+        {
+            gStorePath = optarg;
+            break;
+        }
+        case 'j':
+        {
+            gJobs = atoi(optarg);
+            break;
+        }
+        case 'q':
+        {
+            gQuiet = true;
+            break;
+        }
+        case 'h':
+        default:
+        {
+            usage();
+            break;
+        }
+        }
+    }
+
+    if (argc - optind < 2 || gNumDeals <= 0 || gJobs <= 0)
+        usage();
+}
+
+std::vector<uint128_t> readDeals(const char* path)
+{
+    const DealCorpus corpus(path);
+    return std::vector<uint128_t>(corpus.Deals(), corpus.Deals() + corpus.Size());
+}
+
+std::vector<uint128_t> generateDeals(int n, uint64_t seed)
+{
+    // The corpus depends only on the seed, so later leagues play the same deals.
+    const RandomGenerator rng(seed);
+    std::vector<uint128_t> deals(n);
+    for (int i = 0; i < n; ++i)
+        deals[i] = Deal::RandomDealIndex(rng);
+    return deals;
+}
+
+int main(int argc, char** argv)
+{
+    parseArgs(argc, argv);
+
+    const std::vector<std::string> specs(argv + optind, argv + argc);
+    const std::vector<uint128_t> deals = gDealsPath ? readDeals(gDealsPath) : generateDeals(gNumDeals, gSeed);
+
+    League league(specs, deals, gStorePath, gQuiet);
+
+    const double startTime = now();
+    const int played = league.run(gJobs, gSeed);
+    const double elapsed = now() - startTime;
+    if (!gQuiet)
+        printf("Played %d matches in %4.2f seconds\n", played, elapsed);
+
+    league.printRatings();
+    return 0;
+}
@@ -0,0 +1,64 @@
+// lib/AnnotationRecord.h
+
+#pragma once
+
+#include "lib/PackedKnowableState.h"
+
+#include <string.h>
+
+// The binary counterpart of the text blocks written by WriteDataAnnotator.
+// An annotation file is one AnnotationFileHeader followed by any number of fixed-width AnnotationRecords.
+// Everything is written in native (little-endian x86) layout.
+
+const char kAnnotationMagic[8] = {'H', 'N', 'N', 'A', 'N', 'N', 'O', 'T'};
+const uint32_t kAnnotationVersion = 1;
+
+struct AnnotationFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+};
+
+struct AnnotationRecord
+{
+  PackedKnowableState state;
+
+  uint8_t numChoices;
+  uint8_t choices[13];
+  // The legal plays in ascending card order. The per-choice label arrays below use the same order.
+
+  uint8_t pad[2];
+
+  float prob[52][4];
+  // Exact P(player holds card), from the PossibilityAnalyzer's expected distribution.
+  // Rows for cards already played are all zeros.
+
+  float expectedScore[13];
+  // Expected additional points taken for each choice, in the range 0..26.
+
+  float winsTrickProb[13];
+
+  float moonProb[13][3];
+  // Indexed by MoonCountKey, plus a third column for neither player shooting the moon.
+
+  uint8_t reserved[4];
+  // Makes the implicit tail padding explicit, so records are fully initialized on disk.
+};
+
+static_assert(sizeof(AnnotationFileHeader) == 16, "AnnotationFileHeader is an on-disk format");
+static_assert(sizeof(AnnotationRecord) == 1160, "AnnotationRecord is an on-disk format");
+static_assert(std::is_trivially_copyable<AnnotationRecord>::value, "AnnotationRecord is an on-disk format");
+
+inline void InitAnnotationFileHeader(AnnotationFileHeader& header)
+{
+  memcpy(header.magic, kAnnotationMagic, sizeof(header.magic));
+  header.version = kAnnotationVersion;
+  header.recordSize = sizeof(AnnotationRecord);
+}
+
+inline bool IsValidAnnotationFileHeader(const AnnotationFileHeader& header)
+{
+  return memcmp(header.magic, kAnnotationMagic, sizeof(header.magic)) == 0 && header.version == kAnnotationVersion
+      && header.recordSize == sizeof(AnnotationRecord);
+}
@@ -26,3 +26,8 @@ void Annotator::OnWriteData(const KnowableState& state, PossibilityAnalyzer* ana
 {
   assert(false);
 }
+
+void Annotator::OnRolloutSample(const KnowableState& state, Card play, float expectedScore, const float moonProb[3]
+                          , float winsTrickProb)
+{
+}
@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include "lib/Card.h"
+
 #include <string>
 #include <memory>
 
@@ -24,4 +26,10 @@ public:
 
   virtual void OnWriteData(const KnowableState& state, PossibilityAnalyzer* analyzer, const float expectedScore[13]
   , const float moonProb[13][3], const float winsTrickProb[13]);
+
+  virtual void OnRolloutSample(const KnowableState& state, Card play, float expectedScore, const float moonProb[3]
+  , float winsTrickProb);
+    // A position sampled from inside a MonteCarlo rollout, labelled with the single outcome of that rollout.
+    // Only `play` (the card the intuition chose) is labelled; the labels have the same meaning as in OnWriteData.
+    // This hook is optional: the default implementation ignores the sample.
 };
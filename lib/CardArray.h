@@ -161,6 +161,9 @@ public:
 
   unsigned CountCardsWithSuit(Suit suit) const { return CountCardsWithMask(SuitMask(suit)); }
 
+  uint64_t Bits() const { return mCardBits; }
+    // The raw card bit mask, e.g. for binary serialization. Use CardArray(bits, kGiven) to reconstruct.
+
   CardArray NonPointCards() const;
 
   void PartitionRemaining(Suit suit, CardArray& remaininOfSuit, CardArray& otherRemaining) const;
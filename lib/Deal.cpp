@@ -13,6 +13,7 @@ using namespace std;
 #include "lib/random.h"
 
 static uint128_t kPossibleDistinguishableDeals = possibleDistinguishableDeals();
+static const BoundedRange128 kDealIndexes(kPossibleDistinguishableDeals);
 
 int Deal::startPlayer() const
 {
@@ -39,11 +40,15 @@ Deal::Deal(uint128_t index)
   DealHands(mDealIndex);
 }
 
-static RandomGenerator gRand;
-
 uint128_t Deal::RandomDealIndex()
 {
-  return gRand.range128(kPossibleDistinguishableDeals);
+  // Each thread has its own generator; a shared one would be a data race.
+  return RandomGenerator::ThreadSpecific().range128(kDealIndexes);
+}
+
+uint128_t Deal::RandomDealIndex(const RandomGenerator& rng)
+{
+  return rng.range128(kDealIndexes);
 }
 
 void Deal::DealHands(uint128_t I)
@@ -84,7 +89,7 @@ uint128_t PossibleDealUnknownsToHands(const CardDeck& unknowns, const CardHands&
 void DealUnknownsToHands(const CardDeck& unknowns, CardHands& hands)
 {
   const uint128_t kPossibleDeals = PossibleDealUnknownsToHands(unknowns, hands);
-  uint128_t index = gRand.range128(kPossibleDeals);
+  uint128_t index = RandomGenerator::Range128(kPossibleDeals);
   DealUnknownsToHands(unknowns, hands, index);
 }
 
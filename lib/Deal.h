@@ -6,6 +6,8 @@
 #include "lib/Card.h"
 #include "lib/CardArray.h"
 
+class RandomGenerator;
+
 uint128_t PossibleDealUnknownsToHands(const CardDeck& unknowns, const CardHands& hands);
 void DealUnknownsToHands(const CardDeck& unknowns, CardHands& hands);
 void DealUnknownsToHands(const CardDeck& unknowns, CardHands& hands, uint128_t index);
@@ -33,6 +35,9 @@ public:
   static uint128_t RandomDealIndex();
     // Generate a random bignum in the range [0, 52!/(13!^4))
 
+  static uint128_t RandomDealIndex(const RandomGenerator& rng);
+    // The same, drawing from the given generator, e.g. to reproduce a deal corpus from a seed.
+
   Card PeekAt(int p, int c) const { return mHands[p].NthCard(c); }
   Card PeekAt(int i) const { return PeekAt(i/13, i%13); }
     // For unit tests, peak at the card at a given card location
@@ -0,0 +1,155 @@
+// lib/DealCorpus.cpp
+
+#include "lib/DealCorpus.h"
+#include "lib/Deal.h"
+#include "lib/random.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(DealCorpusHeader) == 64, "DealCorpusHeader is an on-disk format");
+static_assert(sizeof(uint128_t) == 16, "Deals are packed 128-bit integers");
+
+const char kCorpusMagic[8] = {'H', 'N', 'N', 'D', 'E', 'A', 'L', 'S'};
+const uint32_t kCorpusVersion = 1;
+
+static void fail(const char* what, const std::string& path)
+{
+  fprintf(stderr, "%s %s failed: %s\n", what, path.c_str(), strerror(errno));
+  exit(1);
+}
+
+DealCorpus::~DealCorpus()
+{
+  if (mMapping != nullptr)
+    munmap(mMapping, mMappingSize);
+}
+
+DealCorpus::DealCorpus(const std::string& path)
+: mMapping(nullptr)
+, mMappingSize(0)
+, mDeals(nullptr)
+, mSize(0)
+, mSeed(0)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    fail("open", path);
+
+  DealCorpusHeader header;
+  const ssize_t n = pread(fd, &header, sizeof(header), 0);
+  if (n == sizeof(header) && memcmp(header.magic, kCorpusMagic, sizeof(kCorpusMagic)) == 0)
+  {
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+      fail("fstat", path);
+    if (header.version != kCorpusVersion || header.headerSize != sizeof(header)
+        || size_t(st.st_size) != sizeof(header) + header.count * sizeof(uint128_t))
+    {
+      fprintf(stderr, "%s has a bad header or is truncated\n", path.c_str());
+      exit(1);
+    }
+
+    mMappingSize = st.st_size;
+    mMapping = mmap(NULL, mMappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (mMapping == MAP_FAILED)
+      fail("mmap", path);
+    close(fd);
+
+    // The header is 64 bytes, so the deals are aligned for 128-bit loads.
+    mDeals = (const uint128_t*) ((const char*) mMapping + sizeof(header));
+    mSize = header.count;
+    mSeed = header.seed;
+    return;
+  }
+  close(fd);
+
+  FILE* f = fopen(path.c_str(), "r");
+  if (f == nullptr)
+    fail("fopen", path);
+  char* line = NULL;
+  size_t linecap = 0;
+  while (getline(&line, &linecap, f) > 0)
+  {
+    if (isxdigit(line[0]))
+      mText.push_back(parseHex128(line));
+  }
+  free(line);
+  fclose(f);
+  mDeals = mText.data();
+  mSize = mText.size();
+}
+
+static FILE* createCorpus(const std::string& path, size_t count, uint64_t seed)
+{
+  FILE* f = fopen(path.c_str(), "wb");
+  if (f == nullptr)
+    fail("fopen", path);
+
+  DealCorpusHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kCorpusMagic, sizeof(kCorpusMagic));
+  header.version = kCorpusVersion;
+  header.headerSize = sizeof(header);
+  header.count = count;
+  header.seed = seed;
+  if (fwrite(&header, sizeof(header), 1, f) != 1)
+    fail("fwrite", path);
+  return f;
+}
+
+static void closeCorpus(FILE* f, const std::string& path)
+{
+  if (fclose(f) != 0)
+    fail("fclose", path);
+}
+
+void DealCorpus::Write(const std::string& path, const uint128_t* deals, size_t count, uint64_t seed)
+{
+  FILE* f = createCorpus(path, count, seed);
+  if (count > 0 && fwrite(deals, sizeof(uint128_t), count, f) != count)
+    fail("fwrite", path);
+  closeCorpus(f, path);
+}
+
+void DealCorpus::Generate(const std::string& path, size_t count, uint64_t seed)
+{
+  FILE* f = createCorpus(path, count, seed);
+
+  const RandomGenerator rng(seed);
+  const size_t kChunk = 1 << 16;
+  std::vector<uint128_t> chunk(kChunk);
+  for (size_t done = 0; done < count;)
+  {
+    const size_t n = std::min(kChunk, count - done);
+    for (size_t i = 0; i < n; ++i)
+      chunk[i] = Deal::RandomDealIndex(rng);
+    if (fwrite(chunk.data(), sizeof(uint128_t), n, f) != n)
+      fail("fwrite", path);
+    done += n;
+  }
+  closeCorpus(f, path);
+}
+
+void DealCorpus::ShardRange(size_t size, int shard, int numShards, size_t& begin, size_t& end)
+{
+  assert(numShards > 0 && shard >= 0 && shard < numShards);
+  begin = uint128_t(size) * shard / numShards;
+  end = uint128_t(size) * (shard + 1) / numShards;
+}
+
+bool DealCorpus::ParseShard(const char* spec, int& shard, int& numShards)
+{
+  char slash;
+  return sscanf(spec, "%d%c%d", &shard, &slash, &numShards) == 3 && slash == '/' && numShards > 0 && shard >= 0
+         && shard < numShards;
+}
@@ -0,0 +1,71 @@
+// lib/DealCorpus.h
+
+#pragma once
+
+#include "lib/math.h"
+
+#include <string>
+#include <vector>
+
+// A fixed list of deal indexes to play, e.g. for regression benchmarks.
+//
+// The binary format is a 64 byte header followed by the deal indexes, packed as native (little endian) 128-bit
+// integers. It is memory mapped, so opening a corpus of millions of deals is instant and several processes share
+// one copy in the page cache. The corpus tool generates, converts, prints and splits corpora.
+//
+// For compatibility a corpus may also be a text file with one hex deal index per line (as written by
+// Tournament's saveMoonDeal), which is parsed into memory.
+
+struct DealCorpusHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t count;
+  uint64_t seed;
+  // The seed the deals were generated from, or 0 if they were not.
+
+  char pad[32];
+};
+
+class DealCorpus
+{
+public:
+  ~DealCorpus();
+
+  DealCorpus(const std::string& path);
+  // Opens a binary or text corpus. Exits with a message on failure.
+
+  size_t Size() const { return mSize; }
+
+  const uint128_t* Deals() const { return mDeals; }
+
+  uint128_t operator[](size_t i) const { return mDeals[i]; }
+
+  uint64_t Seed() const { return mSeed; }
+
+  bool IsMapped() const { return mMapping != nullptr; }
+
+  static void Write(const std::string& path, const uint128_t* deals, size_t count, uint64_t seed = 0);
+  // Writes a binary corpus. Exits with a message on failure.
+
+  static void Generate(const std::string& path, size_t count, uint64_t seed);
+  // Writes a binary corpus of count random deals, which depend only on the seed.
+
+  static void ShardRange(size_t size, int shard, int numShards, size_t& begin, size_t& end);
+  // The contiguous range [begin, end) of a corpus of the given size that is shard number `shard` of numShards.
+  // The shards partition the corpus and differ in size by at most one.
+
+  static bool ParseShard(const char* spec, int& shard, int& numShards);
+  // Parses "<shard>/<numShards>", e.g. 0/4, returning false if it is malformed or out of range.
+
+private:
+  DealCorpus(const DealCorpus&); // unimplemented
+
+  void* mMapping;
+  size_t mMappingSize;
+  std::vector<uint128_t> mText;
+  const uint128_t* mDeals;
+  size_t mSize;
+  uint64_t mSeed;
+};
@@ -3,15 +3,71 @@
 #include "lib/DnnModelIntuition.h"
 #include "lib/Card.h"
 #include "lib/KnowableState.h"
+#include "lib/Metrics.h"
 #include "lib/PossibilityAnalyzer.h"
+#include "lib/Throughput.h"
+#include "lib/math.h"
 #include "lib/random.h"
 #include "lib/timer.h"
 
+#include <algorithm>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
 using namespace std;
 using namespace tensorflow;
 
+static MetricTimer gFeaturizeTime("DnnModelIntuition::featurize");
+static MetricTimer gPredictTime("DnnModelIntuition::predict");
+
 DnnModelIntuition::~DnnModelIntuition() { delete mPredictor; }
 
+// FNV-1a over the relative path and content of every file in the saved model directory, in name order,
+// so that retraining or replacing any part of the model changes the hash.
+static void hashFiles(const std::string& root, const std::string& relative, uint64_t& h)
+{
+    auto mix = [&h](const void* data, size_t size) {
+        const unsigned char* p = (const unsigned char*) data;
+        for (size_t i = 0; i < size; ++i)
+            h = (h ^ p[i]) * 0x100000001b3ul;
+    };
+
+    const std::string path = relative.empty() ? root : root + "/" + relative;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return;
+
+    if (S_ISDIR(st.st_mode))
+    {
+        std::vector<std::string> names;
+        DIR* dir = opendir(path.c_str());
+        if (dir == nullptr)
+            return;
+        while (struct dirent* entry = readdir(dir))
+        {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+                names.push_back(entry->d_name);
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+        for (const std::string& name : names)
+            hashFiles(root, relative.empty() ? name : relative + "/" + name, h);
+        return;
+    }
+
+    mix(relative.c_str(), relative.size() + 1);
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr)
+        return;
+    std::vector<char> buffer(1 << 16);
+    size_t n;
+    while ((n = fread(buffer.data(), 1, buffer.size(), f)) > 0)
+        mix(buffer.data(), n);
+    fclose(f);
+}
+
 DnnModelIntuition::DnnModelIntuition(const std::string& modelPath, bool pooled)
     : mPredictor(0)
 {
@@ -29,21 +85,32 @@ DnnModelIntuition::DnnModelIntuition(const std::string& modelPath, bool pooled)
         mPredictor = new PooledPredictor(mModel);
     else
         mPredictor = new SynchronousPredictor(mModel);
+
+    uint64_t h = 0xcbf29ce484222325ul;
+    hashFiles(modelPath, "", h);
+    mFingerprint = "dnn:" + asHexString(h);
 }
 
 Card DnnModelIntuition::predictOutcomes(
     const KnowableState& state, const RandomGenerator& rng, float playExpectedValue[13]) const
 {
-    FloatMatrix matrix = state.AsFloatMatrix();
     Tensor mainData(DT_FLOAT, TensorShape({1, kCardsPerDeck, KnowableState::kNumFeaturesPerCard}));
+    {
+        ScopedTimer timer(gFeaturizeTime);
+        FloatMatrix matrix = state.AsFloatMatrix();
 
-    const float* srcData = matrix.data();
-    float* dstData = mainData.flat<float>().data();
+        const float* srcData = matrix.data();
+        float* dstData = mainData.flat<float>().data();
 
-    memcpy(dstData, srcData, kCardsPerDeck * KnowableState::kNumFeaturesPerCard * sizeof(float));
+        memcpy(dstData, srcData, kCardsPerDeck * KnowableState::kNumFeaturesPerCard * sizeof(float));
+    }
 
     std::vector<tensorflow::Tensor> outputs;
-    mPredictor->Predict(mainData, outputs);
+    {
+        ScopedTimer timer(gPredictTime);
+        mPredictor->Predict(mainData, outputs);
+    }
+    gInferences.Add();
 
     return state.ParsePrediction(outputs, playExpectedValue);
 }
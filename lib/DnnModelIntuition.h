@@ -22,7 +22,11 @@ public:
     virtual Card predictOutcomes(
         const KnowableState& state, const RandomGenerator& rng, float playExpectedValue[13]) const;
 
+    virtual std::string Fingerprint() const { return mFingerprint; }
+    // Plays are the argmax of the model's prediction, so they depend only on the model's content.
+
 private:
     tensorflow::SavedModelBundle mModel;
     Predictor* mPredictor;
+    std::string mFingerprint;
 };
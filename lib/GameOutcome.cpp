@@ -11,6 +11,14 @@ GameOutcome::GameOutcome()
     : mShooter(-1)
 {}
 
+GameOutcome::GameOutcome(const GameOutcome& other)
+    : mScores(other.mScores)
+    , mShotTheMoon(other.mShotTheMoon)
+    , mShooter(other.mShooter)
+{
+  memcpy(mPointTricks, other.mPointTricks, sizeof(mPointTricks));
+}
+
 static int firstWith(const std::array<unsigned, 4>& a, unsigned val)
 {
   for (int i = 0; i < 4; i++)
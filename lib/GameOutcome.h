@@ -45,6 +45,9 @@ public:
 
   const bool shotTheMoon() const { return mShotTheMoon; }
 
+  unsigned PointTricks(unsigned player) const { return mPointTricks[player]; }
+  // The number of tricks with points the player took. With PointsTaken(), enough to Set() an equal outcome.
+
 private:
   std::array<unsigned, 4> mScores;
   unsigned mPointTricks[4];
@@ -2,6 +2,7 @@
 #include "lib/Annotator.h"
 #include "lib/KnowableState.h"
 #include "lib/RandomStrategy.h"
+#include "lib/Throughput.h"
 
 #include <assert.h>
 
@@ -98,6 +99,8 @@ GameOutcome GameState::PlayGame(StrategyPtr players[4], const RandomGenerator& r
     {
       annotator->OnGameStateBeforePlay(*this);
     }
+    if (PointsPlayed() < 26 && LegalPlays().Size() > 1)
+      gDecisions.Add();
     NextPlay(player, rng);
   }
   return CheckForShootTheMoon();
@@ -108,6 +111,7 @@ GameOutcome GameState::PlayGame(StrategyPtr players[4], const RandomGenerator& r
 // either the RandomStrategy or the DnnModelIntuition strategy.
 GameOutcome GameState::PlayOutGameMonteCarlo(const StrategyPtr& opponent, const RandomGenerator& rng)
 {
+  gRollouts.Add();
   while (!Done())
   {
     NextPlay(opponent, rng);
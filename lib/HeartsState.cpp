@@ -1,5 +1,6 @@
 #include "lib/HeartsState.h"
 #include "lib/Card.h"
+#include "lib/PackedKnowableState.h"
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
@@ -42,6 +43,48 @@ HeartsState::HeartsState(const HeartsState& other)
   VerifyHeartsState();
 }
 
+HeartsState::HeartsState(const PackedKnowableState& packed)
+    : mDealIndex((uint128_t(packed.dealIndexHi) << 64) | packed.dealIndexLo)
+    , mNextPlay(packed.playNumber)
+    , mLead(packed.lead)
+    , mTrickSuit(kUnknown)
+    , mPointsPlayed(0)
+    , mIsVoidBits(packed.voidBits)
+    , mUnplayedCards(packed.unplayed, kGiven)
+    , mTrackTrickWinsAtPlay(-1)
+    , mTrackTrickWinsForPlayer(-1)
+    , mTrackTrickWinsCounter(0)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    mPlays[i] = packed.trick[i];
+    mScore[i] = packed.score[i];
+    mPointTricks[i] = packed.pointTricks[i];
+    // Points are only ever added to a player's score as they are played, so the two totals are always equal.
+    mPointsPlayed += packed.score[i];
+  }
+  if (PlayInTrick() != 0)
+    mTrickSuit = SuitOf(mPlays[0]);
+  VerifyHeartsState();
+}
+
+void HeartsState::PackInto(PackedKnowableState& packed) const
+{
+  memset(&packed, 0, sizeof(packed));
+  packed.dealIndexLo = uint64_t(mDealIndex);
+  packed.dealIndexHi = uint64_t(mDealIndex >> 64);
+  packed.unplayed = mUnplayedCards.Bits();
+  packed.voidBits = mIsVoidBits.Bits();
+  packed.playNumber = mNextPlay;
+  packed.lead = mLead;
+  for (int i = 0; i < 4; ++i)
+  {
+    packed.trick[i] = mPlays[i];
+    packed.score[i] = mScore[i];
+    packed.pointTricks[i] = mPointTricks[i];
+  }
+}
+
 void HeartsState::VerifyHeartsState() const
 {
 #ifndef NDEBUG
@@ -7,6 +7,8 @@
 
 #include <array>
 
+struct PackedKnowableState;
+
 // HeartsState is an abstract base class, for implementation classes KnowableState and GameState.
 // HeartsState should only contain "knowable" information, i.e. information that any of the 4 players
 // can rightfully know about the state of the game.
@@ -97,6 +99,11 @@ public:
   const std::array<unsigned, 4>& PointsSoFar() const { return mScore; }
 
 protected:
+  HeartsState(const PackedKnowableState& packed);
+  // Restores the state saved by PackInto(). Hand information is handled by the subclass.
+
+  void PackInto(PackedKnowableState& packed) const;
+
   // Returns the player number of the player who wins the trick
   unsigned TrickWinner() const;
 
@@ -2,7 +2,8 @@
 #include "lib/GameState.h"
 #include "lib/PossibilityAnalyzer.h"
 
-#include "lib/DebugStats.h"
+#include "lib/Metrics.h"
+#include "lib/Trace.h"
 
 #include <tensorflow/core/public/session.h>
 #include <tensorflow/core/protobuf/meta_graph.pb.h>
@@ -12,6 +13,8 @@
 
 #include <algorithm>
 
+static MetricTimer gAnalyzeTime("KnowableState::Analyze");
+
 KnowableState::KnowableState(const GameState& gameState)
 : HeartsState((const HeartsState&) gameState)
 , mHand(gameState.CurrentPlayersHand())
@@ -19,6 +22,21 @@ KnowableState::KnowableState(const GameState& gameState)
   VerifyKnowableState();
 }
 
+KnowableState::KnowableState(const PackedKnowableState& packed)
+: HeartsState(packed)
+, mHand(packed.hand, kGiven)
+{
+  VerifyKnowableState();
+}
+
+PackedKnowableState KnowableState::Pack() const
+{
+  PackedKnowableState packed;
+  PackInto(packed);
+  packed.hand = mHand.Bits();
+  return packed;
+}
+
 void KnowableState::VerifyKnowableState() const
 {
   assert(mHand.Size() == ((52-(PlayNumber() & ~0x3u)) / 4));
@@ -74,6 +92,8 @@ void KnowableState::PrepareHands(CardHands& hands) const {
 
 PossibilityAnalyzer* KnowableState::Analyze() const
 {
+  ScopedTimer timer(gAnalyzeTime);
+  TraceSpan span("KnowableState::Analyze");
   CardDeck remaining = UnplayedCardsNotInHand(mHand);
   unsigned player = CurrentPlayer();
 
@@ -530,9 +550,9 @@ Card KnowableState::TransformAndPredict(const tensorflow::SavedModelBundle& mode
   return Predict(model, mainData, playExpectedValue);
 }
 
-DebugStats _expectedDeltaPredictionUnclipped("KnowableState::expectedDeltaPredictionUnclipped");
-DebugStats _expectedPointsPrediction("KnowableState::expectedPointsPrediction");
-DebugStats _expectedScorePrediction("KnowableState::expectedScorePrediction");
+MetricStats _expectedDeltaPredictionUnclipped("KnowableState::expectedDeltaPredictionUnclipped");
+MetricStats _expectedPointsPrediction("KnowableState::expectedPointsPrediction");
+MetricStats _expectedScorePrediction("KnowableState::expectedScorePrediction");
 
 Card KnowableState::ParsePrediction(const std::vector<tensorflow::Tensor>& outputs, float playExpectedValue[13]) const
 {
@@ -573,12 +593,12 @@ Card KnowableState::ParsePrediction(const std::vector<tensorflow::Tensor>& outpu
     Card card = it.next();
 
     float expectedDeltaPrediction = exectedScoreDelta(card);
-    _expectedDeltaPredictionUnclipped.Accum(expectedDeltaPrediction);
+    _expectedDeltaPredictionUnclipped.Record(expectedDeltaPrediction);
     const float kMin = 0.0;
     assert(expectedDeltaPrediction >= kMin);
     float expectedPointsPrediction = (expectedDeltaPrediction * kScoreScale) + kCurrentScore;
     expectedPointsPrediction = std::min(kPredictionScoreMax, expectedPointsPrediction);
-    _expectedPointsPrediction.Accum(expectedPointsPrediction);
+    _expectedPointsPrediction.Record(expectedPointsPrediction);
 
     float expected_score = expectedPointsPrediction - 6.5;
 
@@ -593,7 +613,7 @@ Card KnowableState::ParsePrediction(const std::vector<tensorflow::Tensor>& outpu
     }
     assert(abs(check-1.0) < 0.001);
 
-    _expectedScorePrediction.Accum(expected_score);
+    _expectedScorePrediction.Record(expected_score);
 
     playExpectedValue[i] = expected_score;
     if (bestExpected > expected_score) {
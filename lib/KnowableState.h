@@ -2,6 +2,7 @@
 
 #include "lib/HeartsState.h"
 #include "lib/CardArray.h"
+#include "lib/PackedKnowableState.h"
 
 #include <Eigen/Core>
 #include <unsupported/Eigen/CXX11/Tensor>
@@ -44,6 +45,11 @@ public:
 public:
   KnowableState(const GameState& other);
 
+  explicit KnowableState(const PackedKnowableState& packed);
+    // Reconstructs the exact state saved by Pack().
+
+  PackedKnowableState Pack() const;
+
   GameState HypotheticalState() const;
 
   PossibilityAnalyzer* Analyze() const;
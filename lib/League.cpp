@@ -0,0 +1,267 @@
+// lib/League.cpp
+
+#include "lib/League.h"
+#include "lib/GameState.h"
+#include "lib/Tournament.h"
+#include "dlib/threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <future>
+#include <string.h>
+
+League::~League()
+{
+    if (mStore != nullptr)
+        fclose(mStore);
+}
+
+League::League(
+    const std::vector<std::string>& specs, const std::vector<uint128_t>& deals, const char* storePath, bool quiet)
+    : mSpecs(specs)
+    , mDeals(deals)
+    , mStore(nullptr)
+    , mQuiet(quiet)
+{
+    for (const std::string& spec : mSpecs)
+    {
+        if (mIndex.count(spec) != 0)
+        {
+            fprintf(stderr, "%s is in the league twice\n", spec.c_str());
+            exit(1);
+        }
+        addPlayer(spec);
+        mStrategies.push_back(makePlayer(spec));
+    }
+
+    loadStore(storePath);
+    mStore = fopen(storePath, "a");
+    if (mStore == nullptr)
+    {
+        fprintf(stderr, "fopen %s failed: %s\n", storePath, strerror(errno));
+        exit(1);
+    }
+}
+
+League::MatchKey League::key(const std::string& a, const std::string& b, uint128_t deal)
+{
+    return a < b ? MatchKey(a, b, deal) : MatchKey(b, a, deal);
+}
+
+int League::addPlayer(const std::string& spec)
+{
+    auto it = mIndex.find(spec);
+    if (it != mIndex.end())
+        return it->second;
+    const int index = mRatings.AddPlayer();
+    mNames.push_back(spec);
+    mIndex[spec] = index;
+    return index;
+}
+
+int League::playerIndex(const std::string& spec) const
+{
+    auto it = mIndex.find(spec);
+    return it == mIndex.end() ? -1 : it->second;
+}
+
+void League::loadStore(const char* storePath)
+{
+    FILE* f = fopen(storePath, "r");
+    if (f == nullptr)
+    {
+        if (errno == ENOENT)
+            return;
+        fprintf(stderr, "fopen %s failed: %s\n", storePath, strerror(errno));
+        exit(1);
+    }
+
+    char* line = NULL;
+    size_t linecap = 0;
+    int lineNumber = 0;
+    int loaded = 0;
+    while (getline(&line, &linecap, f) > 0)
+    {
+        ++lineNumber;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        char* fields[4];
+        char* rest = line;
+        int n = 0;
+        while (n < 4 && (fields[n] = strsep(&rest, "\t\n")) != nullptr)
+            ++n;
+        if (n < 4 || fields[0][0] == 0 || fields[1][0] == 0)
+        {
+            fprintf(stderr, "%s:%d: expected <spec a> <spec b> <deal> <advantage>\n", storePath, lineNumber);
+            exit(1);
+        }
+
+        const std::string a(fields[0]);
+        const std::string b(fields[1]);
+        const uint128_t deal = parseHex128(fields[2]);
+        const double advantage = atof(fields[3]);
+
+        // Two leagues appending to the same store may both have played a match. Count it once.
+        if (mPlayed.count(key(a, b, deal)) != 0)
+            continue;
+        recordMatch(addPlayer(a), addPlayer(b), deal, advantage);
+        ++loaded;
+    }
+    free(line);
+    fclose(f);
+
+    mRatings.Fit();
+    if (!mQuiet)
+        printf("Loaded %d matches between %d strategies from %s\n", loaded, mRatings.NumPlayers(), storePath);
+}
+
+void League::recordMatch(int a, int b, uint128_t deal, double advantage)
+{
+    mPlayed.insert(key(mNames[a], mNames[b], deal));
+    mRatings.AddResult(a, b, advantage > 0.0 ? 1.0 : advantage < 0.0 ? 0.0 : 0.5);
+}
+
+int League::numMissingMatches() const
+{
+    int missing = 0;
+    for (size_t a = 0; a < mSpecs.size(); ++a)
+        for (size_t b = a + 1; b < mSpecs.size(); ++b)
+            for (uint128_t deal : mDeals)
+                missing += mPlayed.count(key(mSpecs[a], mSpecs[b], deal)) == 0;
+    return missing;
+}
+
+// FNV-1a, to give each (pair, deal) its own seed independent of the schedule.
+static uint64_t matchSeed(uint64_t seed, const std::string& a, const std::string& b, uint128_t deal)
+{
+    uint64_t h = 0xcbf29ce484222325ul ^ seed;
+    auto mix = [&h](const void* data, size_t size) {
+        const unsigned char* p = (const unsigned char*) data;
+        for (size_t i = 0; i < size; ++i)
+            h = (h ^ p[i]) * 0x100000001b3ul;
+    };
+    mix(a.c_str(), a.size() + 1);
+    mix(b.c_str(), b.size() + 1);
+    mix(&deal, sizeof(deal));
+    return h;
+}
+
+int League::run(int numThreads, uint64_t seed)
+{
+    assert(numThreads >= 1);
+
+    // Each missing match, with its strategies in the canonical (lexicographic) order.
+    struct Match
+    {
+        int a, b; // indexes into mSpecs
+        uint128_t deal;
+        uint64_t seed;
+        StrategyPtr seatings[6][4];
+    };
+    std::vector<Match> matches;
+    for (size_t i = 0; i < mSpecs.size(); ++i)
+    {
+        for (size_t j = i + 1; j < mSpecs.size(); ++j)
+        {
+            const int a = mSpecs[i] < mSpecs[j] ? i : j;
+            const int b = a == int(i) ? j : i;
+            for (uint128_t deal : mDeals)
+            {
+                if (mPlayed.count(key(mSpecs[a], mSpecs[b], deal)) != 0)
+                    continue;
+                Match match;
+                match.a = a;
+                match.b = b;
+                match.deal = deal;
+                match.seed = matchSeed(seed, mSpecs[a], mSpecs[b], deal);
+                Tournament::MakeSeatings(mStrategies[a], mStrategies[b], match.seatings);
+                matches.push_back(match);
+            }
+        }
+    }
+
+    const int kNumMatches = matches.size();
+    if (!mQuiet)
+        printf("Playing %d matches\n", kNumMatches);
+
+    // Shared state, all guarded by `lock` except the job counter.
+    std::atomic<int> nextJob(0);
+    dlib::mutex lock;
+    std::vector<Scores> matchScores;
+    for (const Match& match : matches)
+        matchScores.push_back(Scores(mStrategies[match.a]));
+    std::vector<int> gamesDone(kNumMatches, 0);
+    int matchesDone = 0;
+
+    const int kNumJobs = kNumMatches * 6;
+    auto worker = [&]() -> int {
+        int played = 0;
+        for (int job = nextJob++; job < kNumJobs; job = nextJob++)
+        {
+            Match& match = matches[job / 6];
+            const int seating = job % 6;
+            const RandomGenerator rng(match.seed, Tournament::GameStream(0, seating));
+
+            Deal deck(match.deal);
+            GameState state(deck);
+            GameOutcome outcome = state.PlayGame(match.seatings[seating], rng);
+            ++played;
+
+            dlib::auto_mutex guard(lock);
+            Scores& scores = matchScores[job / 6];
+            scores.Accumulate(match.seatings[seating], outcome);
+            if (++gamesDone[job / 6] < 6)
+                continue;
+
+            const double advantage = scores.ChampionAdvantage();
+            const std::string& a = mSpecs[match.a];
+            const std::string& b = mSpecs[match.b];
+            fprintf(mStore, "%s\t%s\t%s\t%.4f\n", a.c_str(), b.c_str(), asHexString(match.deal).c_str(), advantage);
+            fflush(mStore);
+            recordMatch(playerIndex(a), playerIndex(b), match.deal, advantage);
+            ++matchesDone;
+            if (!mQuiet)
+                printf("%d/%d %s vs %s %s: %+.2f\n", matchesDone, kNumMatches, a.c_str(), b.c_str(),
+                    asHexString(match.deal).c_str(), advantage);
+        }
+        return played;
+    };
+
+    dlib::thread_pool pool(numThreads);
+    std::vector<std::future<int>> workers(numThreads);
+    for (int i = 0; i < numThreads; ++i)
+        workers[i] = dlib::async(pool, worker);
+    for (int i = 0; i < numThreads; ++i)
+        workers[i].get();
+
+    mRatings.Fit();
+    return matchesDone;
+}
+
+void League::printRatings()
+{
+    mRatings.Fit();
+
+    std::vector<int> order(mRatings.NumPlayers());
+    for (int i = 0; i < mRatings.NumPlayers(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [this](int x, int y) { return mRatings.Elo(x) > mRatings.Elo(y); });
+
+    // Ratings are shown relative to the mean of the rated strategies.
+    double mean = 0.0;
+    for (int i = 0; i < mRatings.NumPlayers(); ++i)
+        mean += mRatings.Elo(i);
+    mean /= std::max(1, mRatings.NumPlayers());
+
+    printf("\n%4s %7s %6s %8s  %s\n", "rank", "elo", "95%", "matches", "strategy");
+    for (int r = 0; r < int(order.size()); ++r)
+    {
+        const int i = order[r];
+        printf("%4d %+7.1f %6.1f %8.0f  %s\n", r + 1, mRatings.Elo(i) - mean, mRatings.EloError(i),
+            mRatings.Games(i), mNames[i].c_str());
+    }
+    printf("\n");
+    fflush(stdout);
+}
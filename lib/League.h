@@ -0,0 +1,79 @@
+// lib/League.h
+
+#pragma once
+
+#include "lib/Ratings.h"
+#include "lib/Strategy.h"
+#include "lib/math.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// A round robin between any number of strategies over a shared corpus of deals, with Bradley-Terry ratings.
+//
+// A match is the usual six games of one deal between two strategies (see Tournament). Each completed match is
+// appended to a results store, one tab separated line per match:
+//   <spec a> <spec b> <deal index hex> <advantage of a>
+// where the advantage is Scores::ChampionAdvantage() with a as the champion. When a league starts, it loads the
+// store and only plays the (pair, deal) matches that are missing, so adding a strategy to a league only plays that
+// strategy's new pairings. Strategies are identified by their makePlayer spec, so a spec naming a model file must
+// be given a new name when the model is retrained.
+//
+// For the ratings each match counts as one game, won by the strategy with the positive advantage.
+
+class League
+{
+public:
+    ~League();
+
+    League(const std::vector<std::string>& specs, const std::vector<uint128_t>& deals, const char* storePath,
+        bool quiet = false);
+    // Loads any existing results from storePath, and opens it to append new ones. Every strategy in the store is
+    // rated, but only those in specs are scheduled.
+
+    int numMissingMatches() const;
+
+    int run(int numThreads, uint64_t seed);
+    // Plays all the missing matches, each game an independent job spread across numThreads workers.
+    // Every game uses its own RandomGenerator seeded from (seed, pair, deal, seating), so a match's result does not
+    // depend on what else is scheduled. Returns the number of matches played.
+
+    void printRatings();
+
+    const Ratings& ratings() const { return mRatings; }
+
+    int playerIndex(const std::string& spec) const;
+    // The index of a strategy in ratings(), or -1 if it has played no matches and is not in this league.
+
+private:
+    League(const League&); // unimplemented
+
+    typedef std::tuple<std::string, std::string, uint128_t> MatchKey;
+    // The two specs in lexicographic order, and the deal.
+
+    static MatchKey key(const std::string& a, const std::string& b, uint128_t deal);
+
+    int addPlayer(const std::string& spec);
+
+    void loadStore(const char* storePath);
+
+    void recordMatch(int a, int b, uint128_t deal, double advantage);
+
+    std::vector<std::string> mSpecs;
+    std::vector<StrategyPtr> mStrategies;
+    // The scheduled strategies, in the order given.
+
+    std::vector<uint128_t> mDeals;
+
+    std::vector<std::string> mNames;
+    std::map<std::string, int> mIndex;
+    // Every rated strategy, indexed as in mRatings.
+
+    std::set<MatchKey> mPlayed;
+    Ratings mRatings;
+    FILE* mStore;
+    bool mQuiet;
+};
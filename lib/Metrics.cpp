@@ -0,0 +1,267 @@
+// lib/Metrics.cpp
+
+#include "lib/Metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <math.h>
+#include <mutex>
+#include <signal.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+static const uint64_t kStartTicks = ReadTicks();
+static const std::chrono::steady_clock::time_point kStartTime = std::chrono::steady_clock::now();
+
+unsigned MetricShard()
+{
+    static std::atomic<unsigned> nextShard(0);
+    thread_local const unsigned shard = nextShard++ % kMetricShards;
+    return shard;
+}
+
+double SecondsPerTick()
+{
+    // A longer baseline makes a better estimate, so wait for a short one at startup.
+    const std::chrono::duration<double> kMinBaseline(0.01);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - kStartTime;
+    if (elapsed < kMinBaseline)
+    {
+        std::this_thread::sleep_for(kMinBaseline - elapsed);
+        elapsed = std::chrono::steady_clock::now() - kStartTime;
+    }
+    const uint64_t ticks = ReadTicks() - kStartTicks;
+    return ticks > 0 ? elapsed.count() / ticks : 0.0;
+}
+
+// The registry is never destroyed, so that metrics in other translation units may outlive this one's statics.
+static std::mutex& registryMutex()
+{
+    static std::mutex* mutex = new std::mutex;
+    return *mutex;
+}
+
+static std::vector<Metric*>& registry()
+{
+    static std::vector<Metric*>* metrics = new std::vector<Metric*>;
+    return *metrics;
+}
+
+Metric::Metric(const char* name)
+    : mName(name)
+{
+    std::lock_guard<std::mutex> lock(registryMutex());
+    registry().push_back(this);
+}
+
+Metric::~Metric()
+{
+    std::lock_guard<std::mutex> lock(registryMutex());
+    std::vector<Metric*>& metrics = registry();
+    metrics.erase(std::remove(metrics.begin(), metrics.end(), this), metrics.end());
+}
+
+// --- MetricCounter ---
+
+uint64_t MetricCounter::Read() const
+{
+    uint64_t count = 0;
+    for (const Shard& shard : mShards)
+        count += shard.count.load(std::memory_order_relaxed);
+    return count;
+}
+
+void MetricCounter::Write(FILE* out) const
+{
+    fprintf(out, "%-40s counter count %llu\n", Name(), (unsigned long long) Read());
+}
+
+// --- MetricHistogram ---
+
+uint64_t MetricHistogram::BucketLowerBound(unsigned bucket)
+{
+    if (bucket < kSubBuckets)
+        return bucket;
+    const unsigned shift = (bucket - kSubBuckets) / kSubBuckets;
+    const uint64_t subBucket = (bucket - kSubBuckets) % kSubBuckets;
+    return (kSubBuckets + subBucket) << shift;
+}
+
+uint64_t MetricHistogram::Snapshot::Percentile(double p) const
+{
+    if (count == 0)
+        return 0;
+    const uint64_t rank = std::max(uint64_t(1), uint64_t(p * count + 0.5));
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < kBuckets; ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return i + 1 < kBuckets ? BucketLowerBound(i + 1) - 1 : UINT64_MAX;
+    }
+    return UINT64_MAX;
+}
+
+void MetricHistogram::Read(Snapshot& snapshot) const
+{
+    memset(&snapshot, 0, sizeof(snapshot));
+    for (const Shard& shard : mShards)
+    {
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+        for (unsigned i = 0; i < kBuckets; ++i)
+            snapshot.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+    }
+    for (unsigned i = 0; i < kBuckets; ++i)
+        snapshot.count += snapshot.buckets[i];
+}
+
+void MetricHistogram::Write(FILE* out) const
+{
+    Snapshot snapshot;
+    Read(snapshot);
+    WriteSnapshot(out, snapshot);
+}
+
+void MetricHistogram::WriteSnapshot(FILE* out, const Snapshot& s) const
+{
+    const double mean = s.count > 0 ? double(s.sum) / s.count : 0.0;
+    fprintf(out, "%-40s histogram count %llu mean %.2f p50 %llu p90 %llu p99 %llu max %llu %s\n", Name(),
+        (unsigned long long) s.count, mean, (unsigned long long) s.Percentile(0.5),
+        (unsigned long long) s.Percentile(0.9), (unsigned long long) s.Percentile(0.99),
+        (unsigned long long) s.Percentile(1.0), mUnit);
+}
+
+// --- MetricTimer ---
+
+void MetricTimer::WriteSnapshot(FILE* out, const Snapshot& s) const
+{
+    const double micros = 1.0e6 * SecondsPerTick();
+    const double mean = s.count > 0 ? micros * s.sum / s.count : 0.0;
+    fprintf(out, "%-40s timer count %llu total %.3fs mean %.2f p50 %.2f p90 %.2f p99 %.2f max %.2f us\n", Name(),
+        (unsigned long long) s.count, micros * s.sum * 1.0e-6, mean, micros * s.Percentile(0.5),
+        micros * s.Percentile(0.9), micros * s.Percentile(0.99), micros * s.Percentile(1.0));
+}
+
+// --- MetricStats ---
+
+static void atomicAdd(std::atomic<double>& a, double x)
+{
+    double old = a.load(std::memory_order_relaxed);
+    while (!a.compare_exchange_weak(old, old + x, std::memory_order_relaxed))
+        ;
+}
+
+static void atomicMin(std::atomic<double>& a, double x)
+{
+    double old = a.load(std::memory_order_relaxed);
+    while (x < old && !a.compare_exchange_weak(old, x, std::memory_order_relaxed))
+        ;
+}
+
+static void atomicMax(std::atomic<double>& a, double x)
+{
+    double old = a.load(std::memory_order_relaxed);
+    while (x > old && !a.compare_exchange_weak(old, x, std::memory_order_relaxed))
+        ;
+}
+
+void MetricStats::Record(double x)
+{
+    Shard& shard = mShards[MetricShard()];
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    atomicAdd(shard.sum, x);
+    atomicAdd(shard.sum2, x * x);
+    atomicMin(shard.min, x);
+    atomicMax(shard.max, x);
+}
+
+void MetricStats::Write(FILE* out) const
+{
+    uint64_t count = 0;
+    double sum = 0.0, sum2 = 0.0, min = 1.0e300, max = -1.0e300;
+    for (const Shard& shard : mShards)
+    {
+        count += shard.count.load(std::memory_order_relaxed);
+        sum += shard.sum.load(std::memory_order_relaxed);
+        sum2 += shard.sum2.load(std::memory_order_relaxed);
+        min = std::min(min, shard.min.load(std::memory_order_relaxed));
+        max = std::max(max, shard.max.load(std::memory_order_relaxed));
+    }
+    if (count == 0)
+    {
+        fprintf(out, "%-40s stats count 0\n", Name());
+        return;
+    }
+    const double mean = sum / count;
+    const double std = sqrt(std::max(0.0, sum2 / count - mean * mean));
+    fprintf(out, "%-40s stats count %llu mean %.4f std %.4f min %.4f max %.4f\n", Name(), (unsigned long long) count,
+        mean, std, min, max);
+}
+
+// --- Snapshots ---
+
+void WriteMetrics(FILE* out)
+{
+    std::vector<const Metric*> metrics;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        metrics.assign(registry().begin(), registry().end());
+    }
+    std::sort(metrics.begin(), metrics.end(),
+        [](const Metric* a, const Metric* b) { return strcmp(a->Name(), b->Name()) < 0; });
+
+    const std::chrono::duration<double> uptime = std::chrono::steady_clock::now() - kStartTime;
+    fprintf(out, "# metrics at %lld, uptime %.3fs\n", (long long) time(nullptr), uptime.count());
+    for (const Metric* metric : metrics)
+        metric->Write(out);
+    fflush(out);
+}
+
+static volatile sig_atomic_t gMetricsRequested = 0;
+
+static void requestMetrics(int) { gMetricsRequested = 1; }
+
+void StartMetricsReporter(const char* path, double intervalSeconds)
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestMetrics;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, nullptr);
+
+    const std::string pathCopy = path != nullptr ? path : "";
+    std::thread([pathCopy, intervalSeconds]() {
+        const std::chrono::milliseconds kPoll(50);
+        const std::chrono::duration<double> interval(intervalSeconds);
+        std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+        while (true)
+        {
+            std::this_thread::sleep_for(kPoll);
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            const bool due = intervalSeconds > 0.0 && now - last >= interval;
+            if (!gMetricsRequested && !due)
+                continue;
+            gMetricsRequested = 0;
+            last = now;
+
+            if (pathCopy.empty())
+            {
+                WriteMetrics(stderr);
+                continue;
+            }
+            FILE* out = fopen(pathCopy.c_str(), "a");
+            if (out == nullptr)
+            {
+                fprintf(stderr, "Cannot write metrics to %s: %s\n", pathCopy.c_str(), strerror(errno));
+                continue;
+            }
+            WriteMetrics(out);
+            fclose(out);
+        }
+    }).detach();
+}
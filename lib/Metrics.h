@@ -0,0 +1,190 @@
+// lib/Metrics.h
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Always-on process metrics, cheap enough to leave in the engine's hot paths: counters, log-linear histograms,
+// value statistics and scoped timers. Each metric is a global registered by name, e.g.
+//
+//   MetricCounter gWidgets("widgets");
+//   MetricTimer gFrobTime("frob");
+//   ...
+//   gWidgets.Add();
+//   { ScopedTimer timer(gFrobTime); frob(); }
+//
+// Updates never take a lock. Every metric is split into kMetricShards cache line aligned shards, and each thread
+// updates the shard it was assigned when it first touched a metric, with relaxed atomics, so threads on different
+// shards never contend for a cache line. Reading a metric sums its shards, and is only approximate while it is
+// being updated.
+//
+// WriteMetrics writes a snapshot of every metric. StartMetricsReporter writes one on SIGUSR1 and/or periodically,
+// so that a long run can be looked at without stopping or rebuilding it.
+
+const unsigned kMetricShards = 16;
+
+unsigned MetricShard();
+// The calling thread's shard.
+
+inline uint64_t ReadTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+// A timestamp for measuring short intervals, from the invariant time stamp counter where there is one.
+
+double SecondsPerTick();
+// Calibrated against the steady clock over the life of the process so far.
+
+class Metric
+{
+public:
+    Metric(const char* name);
+    virtual ~Metric();
+
+    const char* Name() const { return mName; }
+
+    virtual void Write(FILE* out) const = 0;
+    // One line describing the metric.
+
+private:
+    const char* mName;
+};
+
+class MetricCounter : public Metric
+{
+public:
+    MetricCounter(const char* name) : Metric(name) {}
+
+    void Add(uint64_t n = 1) { mShards[MetricShard()].count.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t Read() const;
+
+    virtual void Write(FILE* out) const;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> count{0};
+    };
+    Shard mShards[kMetricShards];
+};
+
+class MetricHistogram : public Metric
+{
+public:
+    static const unsigned kSubBucketBits = 3;
+    static const unsigned kSubBuckets = 1 << kSubBucketBits;
+    static const unsigned kBuckets = kSubBuckets + (64 - kSubBucketBits) * kSubBuckets;
+    // Values below kSubBuckets have a bucket each. Above that, each power of two is split into kSubBuckets equal
+    // buckets, so a bucket's width is at most 1/kSubBuckets of its values.
+
+    MetricHistogram(const char* name, const char* unit = "") : Metric(name), mUnit(unit) {}
+
+    void Record(uint64_t value)
+    {
+        Shard& shard = mShards[MetricShard()];
+        shard.buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    static unsigned BucketOf(uint64_t value)
+    {
+        if (value < kSubBuckets)
+            return unsigned(value);
+        const unsigned log2 = 63 - __builtin_clzll(value);
+        const unsigned shift = log2 - kSubBucketBits;
+        return kSubBuckets + shift * kSubBuckets + unsigned((value >> shift) & (kSubBuckets - 1));
+    }
+
+    static uint64_t BucketLowerBound(unsigned bucket);
+
+    struct Snapshot
+    {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t buckets[kBuckets];
+
+        uint64_t Percentile(double p) const;
+        // The upper bound of the bucket holding the p-th percentile (0 < p <= 1), or 0 when empty.
+    };
+
+    void Read(Snapshot& snapshot) const;
+
+    virtual void Write(FILE* out) const;
+
+protected:
+    virtual void WriteSnapshot(FILE* out, const Snapshot& snapshot) const;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> buckets[kBuckets] = {};
+    };
+    const char* mUnit;
+    Shard mShards[kMetricShards];
+};
+
+class MetricTimer : public MetricHistogram
+{
+public:
+    MetricTimer(const char* name) : MetricHistogram(name) {}
+    // A histogram of intervals in ticks, written in microseconds.
+
+protected:
+    virtual void WriteSnapshot(FILE* out, const Snapshot& snapshot) const;
+};
+
+class ScopedTimer
+{
+public:
+    ScopedTimer(MetricTimer& timer) : mTimer(timer), mStart(ReadTicks()) {}
+    ~ScopedTimer() { mTimer.Record(ReadTicks() - mStart); }
+
+private:
+    MetricTimer& mTimer;
+    const uint64_t mStart;
+};
+
+class MetricStats : public Metric
+{
+public:
+    MetricStats(const char* name) : Metric(name) {}
+    // The count, mean, standard deviation, min and max of a real valued quantity.
+
+    void Record(double x);
+
+    virtual void Write(FILE* out) const;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> count{0};
+        std::atomic<double> sum{0.0};
+        std::atomic<double> sum2{0.0};
+        std::atomic<double> min{1.0e300};
+        std::atomic<double> max{-1.0e300};
+    };
+    Shard mShards[kMetricShards];
+};
+
+void WriteMetrics(FILE* out);
+// Writes a snapshot of every metric, one per line in name order, after a line with the time and uptime.
+
+void StartMetricsReporter(const char* path, double intervalSeconds);
+// Starts a thread that writes a snapshot whenever the process receives SIGUSR1, and every intervalSeconds if that
+// is positive. Snapshots are appended to the file at path, or written to stderr when path is null.
@@ -1,10 +1,11 @@
 #include "lib/MonteCarlo.h"
 #include "lib/Card.h"
-#include "lib/DebugStats.h"
 #include "lib/GameState.h"
 #include "lib/KnowableState.h"
+#include "lib/Metrics.h"
 #include "lib/PossibilityAnalyzer.h"
 #include "lib/RandomStrategy.h"
+#include "lib/Trace.h"
 #include "lib/random.h"
 #include "lib/timer.h"
 
@@ -14,6 +15,10 @@ using namespace dlib;
 
 static logger dlog("MonteCarlo");
 
+static MetricTimer gSampleTime("MonteCarlo::sample");
+static MetricTimer gRolloutTime("MonteCarlo::rollout");
+static MetricStats _meanPointsTaken("MonteCarlo::meanPointsTaken");
+
 #include <algorithm>
 #include <math.h>
 #include <stdlib.h>
@@ -26,9 +31,11 @@ MonteCarlo::MonteCarlo(
     : Strategy(annotator)
     , mIntuition(intuition)
     , kNumAlternates(numAlternates)
-    , kNumThreads(parallel ? (3 * std::thread::hardware_concurrency()) / 4 : 0)
+    , kNumThreads(parallel ? std::max(1u, (3 * std::thread::hardware_concurrency()) / 4) : 0)
     , mParallel(parallel)
+    , mMoveBudget(0.0)
     , mThreadPool(kNumThreads)
+    , mRolloutSampleThreshold(0)
 {
     dlog.set_level(LALL);
 }
@@ -39,8 +46,11 @@ void MonteCarlo::PlayOneAlternate(const KnowableState& knowableState, const Poss
     const unsigned currentPlayer = knowableState.CurrentPlayer();
 
     CardHands hands;
-    knowableState.PrepareHands(hands);
-    analyzer->ActualizePossibility(possibilityIndex, hands);
+    {
+        ScopedTimer timer(gSampleTime);
+        knowableState.PrepareHands(hands);
+        analyzer->ActualizePossibility(possibilityIndex, hands);
+    }
 
     knowableState.IsVoidBits().VerifyVoids(hands);
 
@@ -60,7 +70,7 @@ void MonteCarlo::PlayOneAlternate(const KnowableState& knowableState, const Poss
         next.PlayCard(nextCardPlayed);
 
         // Do one "roll out", i.e. play out the game to the end, using random plays
-        GameOutcome outcome = next.PlayOutGameMonteCarlo(mIntuition, rng);
+        GameOutcome outcome = PlayOutRollout(next, rng);
 
         stats.UntrackTrickWinner(next);
         stats.UpdateForGameOutcome(outcome, currentPlayer, i);
@@ -69,22 +79,90 @@ void MonteCarlo::PlayOneAlternate(const KnowableState& knowableState, const Poss
     stats.FinishedOneAlternate();
 }
 
+void MonteCarlo::SetMoveBudget(double seconds)
+{
+    assert(seconds >= 0.0);
+    mMoveBudget = seconds;
+}
+
+void MonteCarlo::SetRolloutSampleRate(double rate)
+{
+    assert(rate >= 0.0 && rate <= 1.0);
+    assert(getAnnotator() || rate == 0.0);
+    // Compare against a random64() so that the common case costs one random number and no floating point.
+    const double kTwoTo64 = 18446744073709551616.0;
+    const double scaled = rate * kTwoTo64;
+    mRolloutSampleThreshold = scaled >= kTwoTo64 ? UINT64_MAX : uint64_t(scaled);
+}
+
+GameOutcome MonteCarlo::PlayOutRollout(GameState& next, const RandomGenerator& rng) const
+{
+    ScopedTimer timer(gRolloutTime);
+    if (mRolloutSampleThreshold == 0 || next.Done() || rng.random64() >= mRolloutSampleThreshold)
+        return next.PlayOutGameMonteCarlo(mIntuition, rng);
+
+    // Play forward to a uniformly chosen remaining play of this rollout.
+    const unsigned sampledPlay = next.PlayNumber() + rng.range64(kCardsPerDeck - next.PlayNumber());
+    while (next.PlayNumber() < sampledPlay)
+        next.NextPlay(mIntuition, rng);
+
+    // Forced plays teach nothing.
+    if (next.PointsPlayed() == 26 || next.LegalPlays().Size() == 1)
+        return next.PlayOutGameMonteCarlo(mIntuition, rng);
+
+    const KnowableState sampled(next);
+    const unsigned player = next.CurrentPlayer();
+    const unsigned pointsAlreadyTaken = next.GetScoreFor(player);
+    const Card play = next.NextPlay(mIntuition, rng);
+
+    // Finish the trick to learn who won it. The winner leads the next trick.
+    while (next.PlayInTrick() != 0)
+        next.NextPlay(mIntuition, rng);
+    const bool wonTrick = next.PlayerLeadingTrick() == player;
+
+    GameOutcome outcome = next.PlayOutGameMonteCarlo(mIntuition, rng);
+
+    unsigned moonCounts[13][kNumMoonCountKeys];
+    bzero(moonCounts, sizeof(moonCounts));
+    outcome.updateMoonStats(player, 0, moonCounts);
+    float moonProb[kNumMoonCountKeys + 1];
+    moonProb[kCurrentShotTheMoon] = moonCounts[0][kCurrentShotTheMoon];
+    moonProb[kOtherShotTheMoon] = moonCounts[0][kOtherShotTheMoon];
+    moonProb[2] = 1.0 - (moonProb[kCurrentShotTheMoon] + moonProb[kOtherShotTheMoon]);
+
+    const float expectedDelta = float(outcome.PointsTaken(player)) - float(pointsAlreadyTaken);
+    {
+        auto_mutex lock(mRolloutSampleMutex);
+        getAnnotator()->OnRolloutSample(sampled, play, expectedDelta, moonProb, wonTrick ? 1.0 : 0.0);
+    }
+
+    return outcome;
+}
+
 MonteCarlo::Stats MonteCarlo::RunRolloutsTask(const KnowableState& knowableState, PossibilityAnalyzer* analyzer,
-    const CardHand& choices, const RandomGenerator& rng, unsigned kNumAlts) const
+    const CardHand& choices, const RandomGenerator& rng, unsigned kNumAlts, double deadline,
+    const std::atomic<bool>* cancelled) const
 {
-    const uint128_t numPossibilities = analyzer->Possibilities();
+    TraceSpan span("MonteCarlo::RunRolloutsTask");
+    const BoundedRange128 possibilities(analyzer->Possibilities());
     Stats thisTaskStats(choices.Size());
-    for (unsigned alternate = 0; alternate < kNumAlts; ++alternate)
+    unsigned alternate = 0;
+    for (; alternate < kNumAlts; ++alternate)
     {
-        const uint128_t possibilityIndex = rng.range128(numPossibilities);
+        if (alternate > 0 && deadline > 0.0 && now() >= deadline)
+            break;
+        if (alternate > 0 && cancelled != nullptr && cancelled->load(std::memory_order_relaxed))
+            break;
+        const uint128_t possibilityIndex = rng.range128(possibilities);
         PlayOneAlternate(knowableState, analyzer, possibilityIndex, choices, rng, thisTaskStats);
     }
+    span.SetArg("alternates", alternate);
 
     return thisTaskStats;
 }
 
 MonteCarlo::Stats MonteCarlo::RunParallelTasks(const KnowableState& knowableState, const RandomGenerator& rng,
-    PossibilityAnalyzer* analyzer, const CardHand& choices) const
+    PossibilityAnalyzer* analyzer, const CardHand& choices, double deadline) const
 {
     Stats totalStats(choices.Size());
 
@@ -95,14 +173,19 @@ MonteCarlo::Stats MonteCarlo::RunParallelTasks(const KnowableState& knowableStat
 
     std::vector<std::future<Stats>> taskStats(kNumThreads);
 
+    // Each task's generator is a stream of a seed drawn from the caller's, so a seeded caller gets reproducible
+    // rollouts.
+    const uint64_t tasksSeed = rng.random64();
     for (int i = 0; i < kNumThreads; ++i)
     {
-        taskStats[i] = dlib::async(mThreadPool, [this, i, knowableState, analyzer, choices, kNumAlts]() {
-            const RandomGenerator& rng = RandomGenerator::ThreadSpecific();
-            return this->RunRolloutsTask(knowableState, analyzer, choices, rng, kNumAlts);
-        });
+        taskStats[i] = dlib::async(
+            mThreadPool, [this, i, knowableState, analyzer, choices, kNumAlts, tasksSeed, deadline]() {
+                const RandomGenerator rng(tasksSeed, i);
+                return this->RunRolloutsTask(knowableState, analyzer, choices, rng, kNumAlts, deadline, nullptr);
+            });
     }
 
+    TraceSpan span("MonteCarlo::waitForTasks");
     for (int i = 0; i < kNumThreads; ++i)
         totalStats += taskStats[i].get();
 
@@ -117,10 +200,16 @@ Card MonteCarlo::predictOutcomes(
     return mIntuition->predictOutcomes(state, rng, playExpectedValue);
 }
 
+Card MonteCarlo::choosePlay(const KnowableState& knowableState, const RandomGenerator& rng) const
+{
+    return choosePlayBy(knowableState, rng, mMoveBudget > 0.0 ? now() + mMoveBudget : 0.0);
+}
+
 // For each legal play, play out (roll out) the game many times
 // Compute the expected score of a play as the average score all game rollouts.
-Card MonteCarlo::choosePlay(const KnowableState& knowableState, const RandomGenerator& rng) const
+Card MonteCarlo::choosePlayBy(const KnowableState& knowableState, const RandomGenerator& rng, double deadline) const
 {
+    TraceSpan span("MonteCarlo::choosePlay");
     // knowableState.VerifyHeartsState();
 
     const CardHand choices = knowableState.LegalPlays();
@@ -135,11 +224,11 @@ Card MonteCarlo::choosePlay(const KnowableState& knowableState, const RandomGene
     Stats totalStats;
     if (!mParallel)
     {
-        totalStats = this->RunRolloutsTask(knowableState, analyzer, choices, rng, kNumAlternates);
+        totalStats = this->RunRolloutsTask(knowableState, analyzer, choices, rng, kNumAlternates, deadline, nullptr);
     }
     else
     {
-        totalStats = RunParallelTasks(knowableState, rng, analyzer, choices);
+        totalStats = RunParallelTasks(knowableState, rng, analyzer, choices, deadline);
     }
 
     const AnnotatorPtr annotator = getAnnotator();
@@ -155,10 +244,28 @@ Card MonteCarlo::choosePlay(const KnowableState& knowableState, const RandomGene
 
     delete analyzer;
 
+    _meanPointsTaken.Record(totalStats.MeanPointsTaken());
     Card bestPlay = totalStats.BestPlay(choices);
     return bestPlay;
 }
 
+Card MonteCarlo::ponderPlay(
+    const KnowableState& knowableState, const RandomGenerator& rng, const std::atomic<bool>& cancelled) const
+{
+    const CardHand choices = knowableState.LegalPlays();
+
+    if (choices.Size() == 1)
+        return choices.FirstCard();
+
+    assert(knowableState.PointsPlayed() < 26);
+
+    PossibilityAnalyzer* analyzer = knowableState.Analyze();
+    const Stats totalStats = RunRolloutsTask(knowableState, analyzer, choices, rng, kNumAlternates, 0.0, &cancelled);
+    delete analyzer;
+
+    return totalStats.BestPlay(choices);
+}
+
 // mTotalPoints is the cumulated points across all simulated alternates for each legal play
 // points come directly from GameState where they are in the range of 0..26.
 unsigned mTotalPoints[13];
@@ -169,10 +276,9 @@ unsigned mTotalTrickWins[13];
 
 unsigned mTotalMoonCounts[13][kNumMoonCountKeys];
 
-DebugStats _UpdateForGameOutcome("MonteCarlo::Stats::UpdateForGameOutcome");
-DebugStats _expectedPoints("MonteCarlo::expectedPoints");
-DebugStats _expectedDelta("MonteCarlo::expectedDelta");
-DebugStats _standardScoreStats("MonteCarlo::standard");
+MetricStats _expectedPoints("MonteCarlo::expectedPoints");
+MetricStats _expectedDelta("MonteCarlo::expectedDelta");
+MetricStats _standardScoreStats("MonteCarlo::standard");
 
 MonteCarlo::Stats::Stats(unsigned numLegalPlays)
     : mNumLegalPlays(numLegalPlays)
@@ -187,10 +293,18 @@ void MonteCarlo::Stats::UpdateForGameOutcome(const GameOutcome& outcome, int cur
 {
     outcome.updateMoonStats(currentPlayer, iPlay, mTotalMoonCounts);
     unsigned pointsTaken = outcome.PointsTaken(currentPlayer);
-    _UpdateForGameOutcome.Accum(float(pointsTaken));
     mTotalPoints[iPlay] += pointsTaken;
 }
 
+float MonteCarlo::Stats::MeanPointsTaken() const
+{
+    unsigned totalPoints = 0;
+    for (unsigned i = 0; i < mNumLegalPlays; ++i)
+        totalPoints += mTotalPoints[i];
+    const unsigned rollouts = mTotalAlternates * mNumLegalPlays;
+    return rollouts > 0 ? float(totalPoints) / rollouts : 0.0f;
+}
+
 void MonteCarlo::Stats::TrackTrickWinner(GameState& next, int iPlay) { next.TrackTrickWinner(mTotalTrickWins + iPlay); }
 
 void MonteCarlo::Stats::UntrackTrickWinner(GameState& next) { next.TrackTrickWinner(0); }
@@ -211,17 +325,18 @@ Card MonteCarlo::Stats::BestPlay(const CardHand& choices) const
     float bestScore = 1e10;
     for (unsigned i = 0; i < choices.Size(); ++i)
     {
-        float expectedPoints = mTotalPoints[i] * kScale;
+        // Divide rather than multiply by kScale, so that e.g. 26 points in every alternate is exactly 26.0
+        float expectedPoints = float(mTotalPoints[i]) / mTotalAlternates;
 
         assert(expectedPoints >= 0.0);
         assert(expectedPoints <= 26.0);
-        _expectedPoints.Accum(expectedPoints);
+        _expectedPoints.Record(expectedPoints);
 
         float score = expectedPoints - 6.5; // subtract out the mean score for the typical non-moon outcome
         score -= 39.0 * moonProb[i][kCurrentShotTheMoon];
         score += 13.0 * moonProb[i][kOtherShotTheMoon];
 
-        _standardScoreStats.Accum(score);
+        _standardScoreStats.Record(score);
         assert(score >= -19.5);
         assert(score <= 18.5);
 
@@ -256,7 +371,8 @@ void MonteCarlo::Stats::ComputeTargetValues(const CardHand& choices, float moonP
 
     for (unsigned i = 0; i < choices.Size(); ++i)
     {
-        float expectedPoints = mTotalPoints[i] * kScale;
+        // Divide rather than multiply by kScale, so that e.g. 26 points in every alternate is exactly 26.0
+        float expectedPoints = float(mTotalPoints[i]) / mTotalAlternates;
 
         assert(expectedPoints >= kPointsAlreadyTaken);
         assert(expectedPoints <= float(kMaxPointsPerHand)); // we can (rarely) see all points taken here, when a player
@@ -264,7 +380,7 @@ void MonteCarlo::Stats::ComputeTargetValues(const CardHand& choices, float moonP
 
         const float kExpectedDelta = expectedPoints - kPointsAlreadyTaken;
         expectedDelta[i] = kExpectedDelta;
-        _expectedDelta.Accum(kExpectedDelta);
+        _expectedDelta.Record(kExpectedDelta);
     }
 }
 
@@ -33,9 +33,28 @@ public:
 
     virtual Card choosePlay(const KnowableState& state, const RandomGenerator& rng) const;
 
+    virtual Card choosePlayBy(const KnowableState& state, const RandomGenerator& rng, double deadline) const;
+    // An anytime search: rollouts continue until the deadline or until numAlternates alternates are done, whichever
+    // comes first. Every rollout task completes at least one alternate, and the others stop between alternates, so
+    // the search overruns the deadline by at most one alternate. A deadline of zero means none.
+
+    virtual Card ponderPlay(
+        const KnowableState& state, const RandomGenerator& rng, const std::atomic<bool>& cancelled) const;
+    // Does numAlternates alternates serially in the calling thread, never using the search thread pool, and stops
+    // after the current alternate once cancelled is set. Ignores the move budget and the annotator.
+
     virtual Card predictOutcomes(
         const KnowableState& state, const RandomGenerator& rng, float playExpectedValue[13]) const;
 
+    void SetMoveBudget(double seconds);
+    // Makes choosePlay an anytime search with a deadline this many seconds after it is called. Zero (the default)
+    // always does numAlternates alternates, which is reproducible from a seeded generator.
+
+    void SetRolloutSampleRate(double rate);
+    // The probability, per rollout, of passing one position from inside that rollout to the annotator's
+    // OnRolloutSample. The position is chosen uniformly from the rollout's remaining plays. Zero (the default)
+    // disables sampling.
+
 private:
     class Stats
     {
@@ -72,6 +91,9 @@ private:
 
         void FinishedOneAlternate() { ++mTotalAlternates; }
 
+        float MeanPointsTaken() const;
+        // The points the current player took, averaged over every rollout of every legal play.
+
         void ComputeTargetValues(const CardHand& choices, float moonProb[13][kNumMoonCountKeys + 1],
             float winsTrickProb[13], float expectedDelta[13], unsigned pointsAlreadyTaken) const;
 
@@ -99,17 +121,23 @@ private:
     void PlayOneAlternate(const KnowableState& knowableState, const PossibilityAnalyzer* analyzer,
         uint128_t possibilityIndex, const CardHand& choices, const RandomGenerator& rng, Stats& stats) const;
 
+    GameOutcome PlayOutRollout(GameState& next, const RandomGenerator& rng) const;
+
     Stats RunRolloutsTask(const KnowableState& knowableState, PossibilityAnalyzer* analyzer, const CardHand& choices,
-        const RandomGenerator& rng, unsigned kNumAlts) const;
+        const RandomGenerator& rng, unsigned kNumAlts, double deadline, const std::atomic<bool>* cancelled) const;
 
     Stats RunParallelTasks(const KnowableState& knowableState, const RandomGenerator& rng,
-        PossibilityAnalyzer* analyzer, const CardHand& choices) const;
+        PossibilityAnalyzer* analyzer, const CardHand& choices, double deadline) const;
 
 private:
     StrategyPtr mIntuition;
     const uint32_t kNumAlternates;
     const int kNumThreads;
     const bool mParallel;
+    double mMoveBudget;
     mutable dlib::thread_pool mThreadPool;
     dlib::mutex mStatsAccumMutex;
+    uint64_t mRolloutSampleThreshold;
+    mutable dlib::mutex mRolloutSampleMutex;
+    // Rollouts run concurrently when mParallel, but annotators are not thread safe.
 };
@@ -0,0 +1,162 @@
+// lib/OutcomeCache.cpp
+
+#include "lib/OutcomeCache.h"
+#include "lib/GameState.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+OutcomeCache::~OutcomeCache()
+{
+    if (mFile != nullptr)
+        fclose(mFile);
+}
+
+OutcomeCache::OutcomeCache(const char* path)
+    : mFile(nullptr)
+    , mHits(0)
+    , mMisses(0)
+{
+    if (path == nullptr)
+        return;
+
+    load(path);
+    mFile = fopen(path, "a");
+    if (mFile == nullptr)
+    {
+        fprintf(stderr, "fopen %s failed: %s\n", path, strerror(errno));
+        exit(1);
+    }
+}
+
+void OutcomeCache::load(const char* path)
+{
+    FILE* f = fopen(path, "r");
+    if (f == nullptr)
+    {
+        if (errno == ENOENT)
+            return;
+        fprintf(stderr, "fopen %s failed: %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    char* line = NULL;
+    size_t linecap = 0;
+    int lineNumber = 0;
+    while (getline(&line, &linecap, f) > 0)
+    {
+        ++lineNumber;
+
+        // The key is the first five fields, the deal and the four fingerprints.
+        char* end = line;
+        for (int field = 0; field < 5 && end != nullptr; ++field)
+            end = strchr(end + (field > 0), '\t');
+
+        Entry entry;
+        if (end == nullptr
+            || sscanf(end, "%u %u %u %u %u %u %u %u", &entry.pointsTaken[0], &entry.pointsTaken[1],
+                   &entry.pointsTaken[2], &entry.pointsTaken[3], &entry.pointTricks[0], &entry.pointTricks[1],
+                   &entry.pointTricks[2], &entry.pointTricks[3])
+                != 8)
+        {
+            // Most likely the last line of a process that was killed while writing it.
+            fprintf(stderr, "%s:%d: ignoring malformed entry\n", path, lineNumber);
+            continue;
+        }
+        mEntries[std::string(line, end)] = entry;
+    }
+    free(line);
+    fclose(f);
+}
+
+std::string OutcomeCache::Key(uint128_t dealIndex, StrategyPtr players[4])
+{
+    std::string key = asHexString(dealIndex);
+    for (int i = 0; i < 4; ++i)
+    {
+        if (players[i]->getAnnotator())
+            return std::string();
+        const std::string fingerprint = players[i]->Fingerprint();
+        if (fingerprint.empty())
+            return std::string();
+        assert(fingerprint.find_first_of("\t\n") == std::string::npos);
+        key += '\t';
+        key += fingerprint;
+    }
+    return key;
+}
+
+GameOutcome OutcomeCache::toOutcome(const Entry& entry)
+{
+    std::array<unsigned, 4> scores;
+    unsigned pointTricks[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        scores[i] = entry.pointsTaken[i];
+        pointTricks[i] = entry.pointTricks[i];
+    }
+    GameOutcome outcome;
+    outcome.Set(pointTricks, scores);
+    return outcome;
+}
+
+bool OutcomeCache::Lookup(const std::string& key, GameOutcome& outcome) const
+{
+    Entry entry;
+    {
+        dlib::auto_mutex lock(mMutex);
+        auto it = mEntries.find(key);
+        if (it == mEntries.end())
+        {
+            ++mMisses;
+            return false;
+        }
+        ++mHits;
+        entry = it->second;
+    }
+    outcome = toOutcome(entry);
+    return true;
+}
+
+void OutcomeCache::Insert(const std::string& key, const GameOutcome& outcome)
+{
+    Entry entry;
+    for (int i = 0; i < 4; ++i)
+    {
+        entry.pointsTaken[i] = outcome.PointsTaken(i);
+        entry.pointTricks[i] = outcome.PointTricks(i);
+    }
+
+    dlib::auto_mutex lock(mMutex);
+    if (!mEntries.insert(std::make_pair(key, entry)).second)
+        return;
+    if (mFile != nullptr)
+    {
+        fprintf(mFile, "%s\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\n", key.c_str(), entry.pointsTaken[0],
+            entry.pointsTaken[1], entry.pointsTaken[2], entry.pointsTaken[3], entry.pointTricks[0],
+            entry.pointTricks[1], entry.pointTricks[2], entry.pointTricks[3]);
+        fflush(mFile);
+    }
+}
+
+size_t OutcomeCache::Size() const
+{
+    dlib::auto_mutex lock(mMutex);
+    return mEntries.size();
+}
+
+GameOutcome OutcomeCache::PlayGame(uint128_t dealIndex, StrategyPtr players[4], const RandomGenerator& rng)
+{
+    const std::string key = Key(dealIndex, players);
+    GameOutcome outcome;
+    if (!key.empty() && Lookup(key, outcome))
+        return outcome;
+
+    Deal deck(dealIndex);
+    GameState state(deck);
+    outcome = state.PlayGame(players, rng);
+    if (!key.empty())
+        Insert(key, outcome);
+    return outcome;
+}
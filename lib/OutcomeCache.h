@@ -0,0 +1,70 @@
+// lib/OutcomeCache.h
+
+#pragma once
+
+#include "lib/GameOutcome.h"
+#include "lib/Strategy.h"
+#include "lib/math.h"
+
+#include <dlib/threads.h>
+
+#include <string>
+#include <unordered_map>
+
+class RandomGenerator;
+
+// Remembers the outcome of complete games in which every seat is played by a deterministic strategy (one with a
+// non-empty Strategy::Fingerprint()), so that the game need not be played again. Such a game is a function of
+// the deal and the four fingerprints alone.
+//
+// The key is the deal index and the fingerprints in seat order. A DnnModelIntuition fingerprint is a hash of the
+// model's files, so a retrained or replaced model never hits entries recorded with the old one.
+//
+// When given a path, entries are loaded from it and new ones appended, one tab separated line each:
+//   <deal index hex> <fingerprint x4> <points taken x4> <point tricks x4>
+// so the cache persists across runs and can be shared by several processes (each only sees the others' entries
+// when it starts). All methods are thread safe.
+
+class OutcomeCache
+{
+public:
+    ~OutcomeCache();
+
+    OutcomeCache(const char* path = nullptr);
+    // With no path the cache only lives in memory.
+
+    GameOutcome PlayGame(uint128_t dealIndex, StrategyPtr players[4], const RandomGenerator& rng);
+    // Returns the cached outcome of the game when there is one, and otherwise plays the game from the deal and,
+    // if the table is deterministic, caches its outcome.
+
+    static std::string Key(uint128_t dealIndex, StrategyPtr players[4]);
+    // The cache key for the table, or the empty string if any seat is not deterministic or has an annotator
+    // (which must see every play).
+
+    bool Lookup(const std::string& key, GameOutcome& outcome) const;
+
+    void Insert(const std::string& key, const GameOutcome& outcome);
+
+    uint64_t Hits() const { return mHits; }
+    uint64_t Misses() const { return mMisses; }
+    size_t Size() const;
+
+private:
+    OutcomeCache(const OutcomeCache&); // unimplemented
+
+    void load(const char* path);
+
+    struct Entry
+    {
+        unsigned pointsTaken[4];
+        unsigned pointTricks[4];
+    };
+
+    static GameOutcome toOutcome(const Entry& entry);
+
+    std::unordered_map<std::string, Entry> mEntries;
+    FILE* mFile;
+    mutable dlib::mutex mMutex;
+    mutable uint64_t mHits;
+    mutable uint64_t mMisses;
+};
@@ -0,0 +1,43 @@
+// lib/PackedKnowableState.h
+
+#pragma once
+
+#include <stdint.h>
+#include <type_traits>
+
+// PackedKnowableState is a fixed-width, trivially copyable snapshot of everything a KnowableState knows.
+// It is written verbatim into binary files, so fields must only ever be appended (with a format version bump).
+// A KnowableState can be reconstructed from it exactly, without replaying the game from the deal.
+
+struct PackedKnowableState
+{
+  uint64_t dealIndexLo;
+  uint64_t dealIndexHi;
+
+  uint64_t hand;
+  // Card bits for the current player's hand
+
+  uint64_t unplayed;
+  // Card bits for all unplayed cards, including the cards in hand
+
+  uint16_t voidBits;
+  // The raw VoidBits, one nibble per suit, one bit per player
+
+  uint8_t playNumber;
+  // 0..51
+
+  uint8_t lead;
+  // The player leading the current trick
+
+  uint8_t trick[4];
+  // Cards played so far in the current trick, in play order. Only the first PlayInTrick() are meaningful.
+
+  uint8_t score[4];
+  // Points taken so far by each player, 0..26
+
+  uint8_t pointTricks[4];
+  // Number of tricks with points taken by each player
+};
+
+static_assert(sizeof(PackedKnowableState) == 48, "PackedKnowableState is an on-disk format");
+static_assert(std::is_trivially_copyable<PackedKnowableState>::value, "PackedKnowableState is an on-disk format");
@@ -0,0 +1,98 @@
+// lib/Perft.cpp
+
+#include "lib/Perft.h"
+
+#include <atomic>
+#include <dlib/threads.h>
+#include <future>
+
+uint64_t Perft(const GameState& state, unsigned depth, bool bulk)
+{
+    if (depth == 0 || state.Done())
+        return 1;
+
+    const CardHand plays = state.LegalPlays();
+    if (bulk && depth == 1)
+        return plays.Size();
+
+    uint64_t leaves = 0;
+    for (CardHand remaining = plays; remaining.Size() > 0;)
+    {
+        const Card card = remaining.FirstCard();
+        remaining.RemoveCard(card);
+        GameState next(state);
+        next.PlayCard(card);
+        leaves += Perft(next, depth - 1, bulk);
+    }
+    return leaves;
+}
+
+// Appends the positions depth plays below state to positions, or the position where the game finished if sooner.
+static void collectPositions(const GameState& state, unsigned depth, std::vector<GameState>& positions)
+{
+    if (depth == 0 || state.Done())
+    {
+        positions.push_back(state);
+        return;
+    }
+
+    const CardHand plays = state.LegalPlays();
+    for (CardHand remaining = plays; remaining.Size() > 0;)
+    {
+        const Card card = remaining.FirstCard();
+        remaining.RemoveCard(card);
+        GameState next(state);
+        next.PlayCard(card);
+        collectPositions(next, depth - 1, positions);
+    }
+}
+
+uint64_t ParallelPerft(const GameState& state, unsigned depth, unsigned splitDepth, int numThreads, bool bulk)
+{
+    if (numThreads <= 1 || splitDepth == 0 || depth <= splitDepth)
+        return Perft(state, depth, bulk);
+
+    std::vector<GameState> positions;
+    collectPositions(state, splitDepth, positions);
+
+    // Subtrees vary a lot in size, so workers claim them one at a time rather than taking equal shares.
+    std::atomic<size_t> nextPosition(0);
+    auto worker = [&]() {
+        uint64_t leaves = 0;
+        for (size_t i = nextPosition++; i < positions.size(); i = nextPosition++)
+        {
+            const GameState& position = positions[i];
+            leaves += Perft(position, depth - (position.PlayNumber() - state.PlayNumber()), bulk);
+        }
+        return leaves;
+    };
+
+    dlib::thread_pool pool(numThreads);
+    std::vector<std::future<uint64_t>> workers(numThreads);
+    for (int i = 0; i < numThreads; ++i)
+        workers[i] = dlib::async(pool, worker);
+    uint64_t leaves = 0;
+    for (int i = 0; i < numThreads; ++i)
+        leaves += workers[i].get();
+    return leaves;
+}
+
+std::vector<PerftDivision> PerftDivide(const GameState& state, unsigned depth, unsigned splitDepth, int numThreads,
+    bool bulk)
+{
+    assert(depth > 0);
+    std::vector<PerftDivision> divisions;
+    if (state.Done())
+        return divisions;
+
+    const CardHand plays = state.LegalPlays();
+    for (CardHand remaining = plays; remaining.Size() > 0;)
+    {
+        const Card card = remaining.FirstCard();
+        remaining.RemoveCard(card);
+        GameState next(state);
+        next.PlayCard(card);
+        divisions.push_back({card, ParallelPerft(next, depth - 1, splitDepth, numThreads, bulk)});
+    }
+    return divisions;
+}
@@ -0,0 +1,33 @@
+// lib/Perft.h
+
+#pragma once
+
+#include "lib/GameState.h"
+
+#include <vector>
+
+// Perft ("performance test", as in chess engines) counts the leaves of the game tree to a fixed depth using only
+// LegalPlays and PlayCard. The counts are a deterministic function of the legality rules, so they validate the move
+// generator (e.g. after it is rewritten for speed), and the time taken is a throughput number for the core engine.
+//
+// A leaf is a sequence of depth legal plays, or a shorter one that finishes the game. Like LegalPlays, perft treats
+// the plays after all 26 points are taken as forced.
+
+uint64_t Perft(const GameState& state, unsigned depth, bool bulk = true);
+// The number of leaves depth plays below state. With bulk, the last play is counted from LegalPlays().Size()
+// without playing the cards, which is much faster and gives the same count.
+
+uint64_t ParallelPerft(const GameState& state, unsigned depth, unsigned splitDepth, int numThreads, bool bulk = true);
+// The same count, computed by collecting the positions splitDepth plays below state and counting the subtree
+// below each of them on one of numThreads workers.
+
+struct PerftDivision
+{
+    Card play;
+    uint64_t leaves;
+};
+
+std::vector<PerftDivision> PerftDivide(const GameState& state, unsigned depth, unsigned splitDepth, int numThreads,
+    bool bulk = true);
+// The leaves below each of state's legal plays, which sum to Perft(state, depth). When two engines disagree,
+// dividing repeatedly along the play whose counts differ finds the position where their rules differ.
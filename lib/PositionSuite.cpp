@@ -0,0 +1,191 @@
+// lib/PositionSuite.cpp
+
+#include "lib/PositionSuite.h"
+#include "lib/Deal.h"
+#include "lib/DealCorpus.h"
+#include "lib/GameState.h"
+#include "lib/RandomStrategy.h"
+#include "lib/random.h"
+#include "lib/timer.h"
+
+#include <atomic>
+#include <dlib/threads.h>
+#include <errno.h>
+#include <future>
+#include <stdlib.h>
+#include <string.h>
+
+static_assert(sizeof(PositionSuiteHeader) == 32, "PositionSuiteHeader is an on-disk format");
+
+const char kSuiteMagic[8] = {'H', 'N', 'N', 'S', 'U', 'I', 'T', 'E'};
+const uint32_t kSuiteVersion = 1;
+
+static void fail(const char* what, const std::string& path)
+{
+  fprintf(stderr, "%s %s failed: %s\n", what, path.c_str(), strerror(errno));
+  exit(1);
+}
+
+PositionSuite::PositionSuite(const std::string& path)
+: mPositions()
+, mSeed(0)
+{
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == nullptr)
+    fail("fopen", path);
+
+  PositionSuiteHeader header;
+  if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, kSuiteMagic, sizeof(kSuiteMagic)) != 0
+      || header.version != kSuiteVersion || header.recordSize != sizeof(PackedKnowableState))
+  {
+    fprintf(stderr, "%s is not a position suite\n", path.c_str());
+    exit(1);
+  }
+
+  mPositions.resize(header.count);
+  if (header.count > 0 && fread(mPositions.data(), sizeof(PackedKnowableState), header.count, f) != header.count)
+  {
+    fprintf(stderr, "%s is truncated\n", path.c_str());
+    exit(1);
+  }
+  fclose(f);
+  mSeed = header.seed;
+}
+
+void PositionSuite::Write(const std::string& path, const std::vector<PackedKnowableState>& positions, uint64_t seed)
+{
+  FILE* f = fopen(path.c_str(), "wb");
+  if (f == nullptr)
+    fail("fopen", path);
+
+  PositionSuiteHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kSuiteMagic, sizeof(kSuiteMagic));
+  header.version = kSuiteVersion;
+  header.recordSize = sizeof(PackedKnowableState);
+  header.count = positions.size();
+  header.seed = seed;
+  if (fwrite(&header, sizeof(header), 1, f) != 1)
+    fail("fwrite", path);
+  // The deal index would tell a strategy every hand, so it is not stored.
+  std::vector<PackedKnowableState> records(positions);
+  for (PackedKnowableState& record : records)
+  {
+    record.dealIndexLo = 0;
+    record.dealIndexHi = 0;
+  }
+  if (records.size() > 0
+      && fwrite(records.data(), sizeof(PackedKnowableState), records.size(), f) != records.size())
+    fail("fwrite", path);
+  if (fclose(f) != 0)
+    fail("fclose", path);
+}
+
+std::vector<PackedKnowableState> PositionSuite::Generate(size_t count, uint64_t seed, const DealCorpus* deals)
+{
+  const RandomGenerator rng(seed);
+  const StrategyPtr random(new RandomStrategy());
+  std::vector<PackedKnowableState> positions;
+  positions.reserve(count);
+  for (size_t i = 0; positions.size() < count; ++i)
+  {
+    const uint128_t dealIndex = deals != nullptr ? (*deals)[i % deals->Size()] : Deal::RandomDealIndex(rng);
+    GameState state{Deal(dealIndex)};
+    const unsigned playNumber = rng.range64(48);
+    while (state.PlayNumber() < playNumber && state.PointsPlayed() < 26)
+      state.NextPlay(random, rng);
+    while (!state.Done() && state.PointsPlayed() < 26 && state.LegalPlays().Size() == 1)
+      state.NextPlay(random, rng);
+    if (!state.Done() && state.PointsPlayed() < 26)
+      positions.push_back(KnowableState(state).Pack());
+  }
+  return positions;
+}
+
+std::vector<PositionResult> SolvePositions(
+    const PositionSuite& suite, const StrategyPtr& strategy, int numThreads, uint64_t seed)
+{
+  assert(numThreads >= 1);
+  std::vector<PositionResult> results(suite.Size());
+
+  std::atomic<size_t> nextPosition(0);
+  auto worker = [&]() {
+    for (size_t i = nextPosition++; i < suite.Size(); i = nextPosition++)
+    {
+      const KnowableState state = suite.Position(i);
+      const RandomGenerator rng(seed, i);
+      PositionResult& result = results[i];
+      result.numChoices = state.LegalPlays().Size();
+      std::fill(result.expectedValue, result.expectedValue + 13, 0.0f);
+      const double start = now();
+      result.play = strategy->choosePlay(state, rng);
+      result.seconds = delta(start);
+      strategy->predictOutcomes(state, rng, result.expectedValue);
+    }
+  };
+
+  dlib::thread_pool pool(numThreads);
+  std::vector<std::future<void>> workers(numThreads);
+  for (int i = 0; i < numThreads; ++i)
+    workers[i] = dlib::async(pool, worker);
+  for (int i = 0; i < numThreads; ++i)
+    workers[i].get();
+  return results;
+}
+
+void WriteResults(FILE* out, const std::vector<PositionResult>& results)
+{
+  fprintf(out, "# position\tplay\tseconds\texpected values\n");
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const PositionResult& result = results[i];
+    fprintf(out, "%zu\t%u\t%.6f\t", i, unsigned(result.play), result.seconds);
+    for (unsigned j = 0; j < result.numChoices; ++j)
+      fprintf(out, "%s%.4f", j == 0 ? "" : ",", result.expectedValue[j]);
+    fprintf(out, "\n");
+  }
+}
+
+std::vector<PositionResult> ReadResults(const std::string& path)
+{
+  FILE* f = fopen(path.c_str(), "r");
+  if (f == nullptr)
+    fail("fopen", path);
+
+  std::vector<PositionResult> results;
+  char* line = NULL;
+  size_t linecap = 0;
+  while (getline(&line, &linecap, f) > 0)
+  {
+    if (line[0] == '#')
+      continue;
+    size_t position;
+    unsigned play;
+    double seconds;
+    int consumed;
+    if (sscanf(line, "%zu\t%u\t%lf\t%n", &position, &play, &seconds, &consumed) != 3 || position != results.size()
+        || play >= kCardsPerDeck)
+    {
+      fprintf(stderr, "%s: bad line %zu\n", path.c_str(), results.size() + 1);
+      exit(1);
+    }
+    PositionResult result;
+    result.play = play;
+    result.seconds = seconds;
+    result.numChoices = 0;
+    std::fill(result.expectedValue, result.expectedValue + 13, 0.0f);
+    for (char* p = line + consumed; result.numChoices < 13 && *p != '\n' && *p != 0;)
+    {
+      char* end;
+      const float value = strtof(p, &end);
+      if (end == p)
+        break;
+      result.expectedValue[result.numChoices++] = value;
+      p = *end == ',' ? end + 1 : end;
+    }
+    results.push_back(result);
+  }
+  free(line);
+  fclose(f);
+  return results;
+}
@@ -0,0 +1,80 @@
+// lib/PositionSuite.h
+
+#pragma once
+
+#include "lib/KnowableState.h"
+#include "lib/PackedKnowableState.h"
+#include "lib/Strategy.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+class DealCorpus;
+
+// A fixed list of positions to run a strategy on, like the EPD suites of chess engines: regression and performance
+// checks of a strategy's decisions without playing whole games.
+//
+// The binary format is a 32 byte header followed by the positions, each a PackedKnowableState with its deal index
+// zeroed, so a position is exactly what its player knows, and nothing of the other hands.
+
+struct PositionSuiteHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  uint64_t count;
+  uint64_t seed;
+  // The seed the positions were generated from, or 0 if they were not.
+};
+
+class PositionSuite
+{
+public:
+  PositionSuite(const std::string& path);
+  // Reads a suite. Exits with a message on failure.
+
+  size_t Size() const { return mPositions.size(); }
+
+  KnowableState Position(size_t i) const { return KnowableState(mPositions[i]); }
+
+  const PackedKnowableState& Packed(size_t i) const { return mPositions[i]; }
+
+  uint64_t Seed() const { return mSeed; }
+
+  static void Write(const std::string& path, const std::vector<PackedKnowableState>& positions, uint64_t seed = 0);
+  // Writes a suite, zeroing the deal index of each position. Exits with a message on failure.
+
+  static std::vector<PackedKnowableState> Generate(size_t count, uint64_t seed, const DealCorpus* deals = nullptr);
+  // Positions with a choice of play, at every stage of the game, each reached by random play from a deal: the deals
+  // of the corpus in order when one is given, and otherwise random deals. They depend only on the seed (and deals).
+
+private:
+  std::vector<PackedKnowableState> mPositions;
+  uint64_t mSeed;
+};
+
+struct PositionResult
+{
+  Card play;
+  // The play Strategy::choosePlay made, as it would in a game.
+
+  unsigned numChoices;
+  float expectedValue[13];
+  // Strategy::predictOutcomes' value of each legal play, in ascending card order.
+
+  double seconds;
+  // The wall time choosePlay took.
+};
+
+std::vector<PositionResult> SolvePositions(
+    const PositionSuite& suite, const StrategyPtr& strategy, int numThreads, uint64_t seed);
+// Runs the strategy's choosePlay on every position, timing it, and then its predictOutcomes, spread across numThreads
+// workers. Each position is given its own RandomGenerator, stream `position` of the seed, so the results do not
+// depend on the number of threads.
+
+void WriteResults(FILE* out, const std::vector<PositionResult>& results);
+// One tab separated line per position: <position> <card played> <seconds> <comma separated expected values>.
+
+std::vector<PositionResult> ReadResults(const std::string& path);
+// Reads results written by WriteResults. Exits with a message on failure.
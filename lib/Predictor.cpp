@@ -2,6 +2,7 @@
 
 #include "lib/Predictor.h"
 #include "lib/KnowableState.h"
+#include "lib/Trace.h"
 #include <dlib/logger.h>
 #include <unistd.h>
 
@@ -40,6 +41,8 @@ SynchronousPredictor::SynchronousPredictor(const SavedModelBundle& model, const
 
 void SynchronousPredictor::Predict(const Tensor& mainData, vector<Tensor>& outputs) const
 {
+  TraceSpan span("Session::Run");
+  span.SetArg("batch", mainData.dim_size(0));
   auto result = mModel.session->Run({{"main_data:0", mainData}}, mOutTensorNames, {}, &outputs);
   if (!result.ok()) {
     printf("Tensorflow prediction failed: %s\n", result.error_message().c_str());
@@ -49,12 +52,15 @@ void SynchronousPredictor::Predict(const Tensor& mainData, vector<Tensor>& outpu
 
 // --- PooledPredictor ---
 
-static void CopyToDestRow(Eigen::TensorMap<Eigen::Tensor<const float, 2, 1, long>, 16, Eigen::MakePointer> src
-                  ,Eigen::TensorMap<Eigen::Tensor<float, 2, 1, long>, 16, Eigen::MakePointer> dst
-                  ,int row)
+static void CopyToDestRow(const Tensor& src, Tensor& dst, int row)
 {
-  for (int i=0; i<KnowableState::kNumFeatures; ++i) {
-    dst(row, i) = src(0, i);
+  const unsigned kStride = KnowableState::kNumFeatures;
+  assert(src.NumElements() == kStride);
+  auto s = src.flat<float>();
+  auto d = dst.flat<float>();
+  const unsigned kOffset = kStride * row;
+  for (unsigned i=0; i<kStride; ++i) {
+    d(kOffset+i) = s(i);
   }
 }
 
@@ -81,32 +87,47 @@ static void CopySrcRowToDest(const vector<Tensor>& src, vector<Tensor>& dst, int
 
 PooledPredictor::~PooledPredictor()
 {
-  printf("Deleting PooledPredictor\n");
   mRunning = false;
   default_thread_pool().wait_for_task(mTaskId);
+  delete mImplPredictor;
 }
 
-PooledPredictor::PooledPredictor(const SavedModelBundle& model, const vector<string> output_tensor_names)
+PooledPredictor::PooledPredictor(const SavedModelBundle& model, const vector<string> output_tensor_names
+                               , unsigned batchSize, unsigned long batchWaitMillis)
 : mImplPredictor(new SynchronousPredictor(model, output_tensor_names))
+, mBatchSize(batchSize)
+, mBatchWaitMillis(batchWaitMillis)
 , mQueueMutex()
 , mQueue()
 , mRequestsPending()
+, mBatchSizeCounts()
 , mRunning(true)
 , mTaskId(default_thread_pool().add_task(*this, &PooledPredictor::ProcessRequests))
 {
-  assert(false);
+  assert(batchSize > 0);
   dlog.set_level(LALL);
 }
 
+vector<uint64_t> PooledPredictor::BatchSizeCounts() const
+{
+  auto_mutex locker(mQueueMutex);
+  return mBatchSizeCounts;
+}
+
 void PooledPredictor::ProcessOneBatch()
 {
-  unsigned numRequests = mRequestsPending.WaitFor(4, 1);
+  const uint64_t gatherStart = gTracing.load(std::memory_order_relaxed) ? ReadTicks() : 0;
+  unsigned numRequests = mRequestsPending.WaitFor(mBatchSize, mBatchWaitMillis);
   if (numRequests == 0) {
     return;
   }
+  // Only waits that gathered some requests are traced, or an idle predictor would fill the trace.
+  if (gatherStart != 0)
+    RecordTraceSpan("PooledPredictor::gather", gatherStart, ReadTicks(), "requests", numRequests);
 
   // dlog << LINFO << "Batch: " << numRequests;
 
+  TraceSpan span("PooledPredictor::batch");
   auto_mutex locker(mQueueMutex);
 
   assert(numRequests > 0);
@@ -138,14 +159,18 @@ void PooledPredictor::ProcessOneBatch()
 
   // dlog << LINFO << "Queue requests: " << numRequests;
 
-  Tensor mainData(DT_FLOAT, TensorShape({numRequests, KnowableState::kNumFeatures}));
-  auto matrix = mainData.matrix<float>();
+  if (mBatchSizeCounts.size() <= numRequests)
+    mBatchSizeCounts.resize(numRequests+1);
+  ++mBatchSizeCounts[numRequests];
+  span.SetArg("requests", numRequests);
+
+  // Each request is one position, shaped {1, kCardsPerDeck, kNumFeaturesPerCard} as DnnModelIntuition makes it.
+  Tensor mainData(DT_FLOAT, TensorShape({numRequests, kCardsPerDeck, KnowableState::kNumFeaturesPerCard}));
 
   int row = 0;
   for (auto it = queue.begin(); it != queue.end(); ++it, ++row) {
     PredictElement elem = *it;
-    auto src = elem.mMainData.matrix<float>();
-    CopyToDestRow(src, matrix, row);
+    CopyToDestRow(elem.mMainData, mainData, row);
   }
 
   std::vector<Tensor> outputs;
@@ -187,6 +212,7 @@ void PooledPredictor::Predict(const Tensor& mainData, vector<Tensor>& output) co
 {
   static thread_specific_data<Semaphore> doneSemaphore;
   assert(output.size() == 0);
+  TraceSpan span("PooledPredictor::wait");
   EnqueueOneRequest(mainData, output, doneSemaphore.data());
   doneSemaphore.data().Acquire();
   assert(output.size() == 2);
@@ -39,10 +39,16 @@ class PooledPredictor : public Predictor
 public:
   virtual ~PooledPredictor();
 
-  PooledPredictor(const tensorflow::SavedModelBundle& model, const std::vector<std::string> output_tensor_names = {});
+  PooledPredictor(const tensorflow::SavedModelBundle& model, const std::vector<std::string> output_tensor_names = {}
+                , unsigned batchSize = 4, unsigned long batchWaitMillis = 1);
+    // Requests are run in batches: the batch thread waits up to batchWaitMillis for batchSize requests to be pending,
+    // then runs all requests pending at that moment, which may be more or fewer than batchSize.
 
   virtual void Predict(const tensorflow::Tensor& mainData, std::vector<tensorflow::Tensor>& outputs) const;
 
+  std::vector<uint64_t> BatchSizeCounts() const;
+    // The number of batches run of each size so far, indexed by batch size.
+
 private:
   void EnqueueOneRequest(const tensorflow::Tensor& mainData, std::vector<tensorflow::Tensor>& output, Semaphore& sem) const;
 
@@ -63,9 +69,12 @@ private:
 
 private:
   SynchronousPredictor* mImplPredictor;
+  const unsigned mBatchSize;
+  const unsigned long mBatchWaitMillis;
   mutable dlib::mutex mQueueMutex;
   mutable std::forward_list<PredictElement> mQueue;
   mutable Semaphore mRequestsPending;
+  std::vector<uint64_t> mBatchSizeCounts;  // guarded by mQueueMutex
   volatile bool mRunning;
   uint64_t mTaskId;
 };
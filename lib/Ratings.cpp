@@ -0,0 +1,94 @@
+// lib/Ratings.cpp
+
+#include "lib/Ratings.h"
+
+#include <assert.h>
+#include <math.h>
+
+// The virtual draw against the reference player
+const double kPriorGames = 1.0;
+
+// Natural log units to Elo points
+const double kEloScale = 400.0 / log(10.0);
+
+Ratings::Ratings(int numPlayers)
+{
+    for (int i = 0; i < numPlayers; ++i)
+        AddPlayer();
+}
+
+int Ratings::AddPlayer()
+{
+    const int player = NumPlayers();
+    for (auto& row : mGames)
+        row.push_back(0.0);
+    mGames.push_back(std::vector<double>(player + 1, 0.0));
+    mWins.push_back(0.0);
+    mStrength.push_back(1.0);
+    return player;
+}
+
+void Ratings::AddResult(int a, int b, double scoreA)
+{
+    assert(a != b);
+    assert(scoreA >= 0.0 && scoreA <= 1.0);
+    mGames[a][b] += 1.0;
+    mGames[b][a] += 1.0;
+    mWins[a] += scoreA;
+    mWins[b] += 1.0 - scoreA;
+}
+
+void Ratings::Fit(int maxIterations, double tolerance)
+{
+    // The minorization-maximization iteration of Hunter (2004), "MM algorithms for generalized Bradley-Terry models":
+    //   gamma_i = W_i / sum_j n_ij / (gamma_i + gamma_j)
+    // with the reference player's gamma fixed at 1.
+    const int n = NumPlayers();
+    std::vector<double> next(n);
+    for (int iteration = 0; iteration < maxIterations; ++iteration)
+    {
+        double change = 0.0;
+        for (int i = 0; i < n; ++i)
+        {
+            double denominator = kPriorGames / (mStrength[i] + 1.0);
+            for (int j = 0; j < n; ++j)
+            {
+                if (mGames[i][j] > 0.0)
+                    denominator += mGames[i][j] / (mStrength[i] + mStrength[j]);
+            }
+            next[i] = (mWins[i] + 0.5 * kPriorGames) / denominator;
+            change = fmax(change, fabs(log(next[i] / mStrength[i])));
+        }
+        mStrength.swap(next);
+        if (change < tolerance)
+            break;
+    }
+}
+
+double Ratings::Elo(int player) const { return kEloScale * log(mStrength[player]); }
+
+double Ratings::EloError(int player) const
+{
+    // d2/dtheta2 of the log likelihood, for theta = log(gamma)
+    double information = 0.0;
+    const double gi = mStrength[player];
+    for (int j = 0; j < NumPlayers(); ++j)
+    {
+        if (mGames[player][j] > 0.0)
+        {
+            const double p = gi / (gi + mStrength[j]);
+            information += mGames[player][j] * p * (1.0 - p);
+        }
+    }
+    const double p = gi / (gi + 1.0);
+    information += kPriorGames * p * (1.0 - p);
+    return 1.96 * kEloScale / sqrt(information);
+}
+
+double Ratings::Games(int player) const
+{
+    double games = 0.0;
+    for (double g : mGames[player])
+        games += g;
+    return games;
+}
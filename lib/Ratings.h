@@ -0,0 +1,47 @@
+// lib/Ratings.h
+
+#pragma once
+
+#include <vector>
+
+// Bradley-Terry ratings for a set of players from pairwise results, reported on the Elo scale.
+//
+// Results are accumulated incrementally with AddResult(), and Fit() refines the previous fit, so refitting after
+// a few new results converges in a handful of iterations. Each player also plays one virtual drawn game against
+// a fixed reference of rating 0, which keeps the fit finite for players that have only wins or only losses.
+// Confidence intervals use the diagonal of the observed Fisher information, which is adequate when each player
+// has played several opponents.
+
+class Ratings
+{
+public:
+    Ratings(int numPlayers = 0);
+
+    int NumPlayers() const { return int(mStrength.size()); }
+
+    int AddPlayer();
+    // Returns the index of the new player, with an initial rating of 0.
+
+    void AddResult(int a, int b, double scoreA);
+    // Records one game between players a and b, with scoreA 1 for a win by a, 0 for a loss, 0.5 for a draw.
+
+    void Fit(int maxIterations = 1000, double tolerance = 1e-9);
+
+    double Elo(int player) const;
+    // The player's rating, with the reference at 0. Only differences between ratings are meaningful.
+
+    double EloError(int player) const;
+    // The half width of a 95% confidence interval for Elo(player).
+
+    double Games(int player) const;
+
+private:
+    std::vector<std::vector<double>> mGames;
+    // mGames[a][b] is the number of games between a and b (symmetric)
+
+    std::vector<double> mWins;
+    // Total score of each player, draws counting one half
+
+    std::vector<double> mStrength;
+    // Bradley-Terry strength, gamma = exp(rating in natural units)
+};
@@ -0,0 +1,187 @@
+// lib/ReplayBuffer.cpp
+
+#include "lib/ReplayBuffer.h"
+#include "lib/random.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "The cursors are shared between processes");
+static_assert(offsetof(ReplayBufferHeader, reserved) == 64, "ReplayBufferHeader is an on-disk format");
+static_assert(offsetof(ReplayBufferHeader, committed) == 128, "ReplayBufferHeader is an on-disk format");
+
+const char kReplayMagic[8] = {'H', 'N', 'N', 'R', 'E', 'P', 'L', 'Y'};
+const uint32_t kReplayVersion = 1;
+const uint32_t kReplayHeaderSize = 4096;
+const uint32_t kRowFloats[4] = {KnowableState::kNumFeatures, kCardsPerDeck, kCardsPerDeck, kCardsPerDeck * 3};
+
+static size_t FileSizeFor(uint64_t capacity)
+{
+  size_t rowFloats = 0;
+  for (int i=0; i<4; ++i)
+    rowFloats += kRowFloats[i];
+  return kReplayHeaderSize + capacity * rowFloats * sizeof(float);
+}
+
+static void ThrowErrno(const std::string& what)
+{
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+ReplayBuffer::~ReplayBuffer()
+{
+  munmap(mHeader, mSize);
+}
+
+ReplayBuffer::ReplayBuffer(const std::string& path, uint64_t capacity)
+: mSize(0)
+, mHeader(0)
+, mMain(0)
+, mScore(0)
+, mTrick(0)
+, mMoon(0)
+{
+  void* base = MAP_FAILED;
+  if (capacity != 0) {
+    // The new file is laid out under a temporary name and then linked into place, so other processes only ever
+    // see a complete header. link() (unlike rename()) fails if another process published its file first.
+    const std::string tempPath = path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(tempPath.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644);
+    if (fd == -1)
+      ThrowErrno("Error creating replay buffer " + tempPath);
+    mSize = FileSizeFor(capacity);
+    if (ftruncate(fd, mSize) != 0) {
+      const int error = errno;
+      ::close(fd);
+      ::unlink(tempPath.c_str());
+      errno = error;
+      ThrowErrno("Error sizing replay buffer " + tempPath);
+    }
+    base = mmap(NULL, mSize, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+      const int error = errno;
+      ::unlink(tempPath.c_str());
+      errno = error;
+      ThrowErrno("Error mapping replay buffer " + tempPath);
+    }
+
+    // The file is zero filled, so both cursors start at zero.
+    mHeader = (ReplayBufferHeader*) base;
+    mHeader->version = kReplayVersion;
+    mHeader->headerSize = kReplayHeaderSize;
+    mHeader->capacity = capacity;
+    memcpy(mHeader->rowFloats, kRowFloats, sizeof(kRowFloats));
+    memcpy(mHeader->magic, kReplayMagic, sizeof(kReplayMagic));
+
+    const bool published = ::link(tempPath.c_str(), path.c_str()) == 0;
+    const int error = errno;
+    ::unlink(tempPath.c_str());
+    if (!published) {
+      munmap(base, mSize);
+      base = MAP_FAILED;
+      if (error != EEXIST) {
+        errno = error;
+        ThrowErrno("Error creating replay buffer " + path);
+      }
+    }
+  }
+
+  if (base == MAP_FAILED) {
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd == -1)
+      ThrowErrno("Error opening replay buffer " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      const int error = errno;
+      ::close(fd);
+      errno = error;
+      ThrowErrno("Error reading replay buffer " + path);
+    }
+    mSize = st.st_size;
+    if (mSize < kReplayHeaderSize) {
+      ::close(fd);
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument), "Not a replay buffer: " + path);
+    }
+    base = mmap(NULL, mSize, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+      ThrowErrno("Error mapping replay buffer " + path);
+  }
+  mHeader = (ReplayBufferHeader*) base;
+
+  if (memcmp(mHeader->magic, kReplayMagic, sizeof(kReplayMagic)) != 0 || mHeader->version != kReplayVersion
+      || mHeader->headerSize != kReplayHeaderSize || memcmp(mHeader->rowFloats, kRowFloats, sizeof(kRowFloats)) != 0
+      || mHeader->capacity == 0 || mSize != FileSizeFor(mHeader->capacity)) {
+    munmap(base, mSize);
+    throw std::system_error(std::make_error_code(std::errc::invalid_argument), "Bad replay buffer header: " + path);
+  }
+
+  const uint64_t kCapacity = mHeader->capacity;
+  mMain = (float*) ((char*) base + kReplayHeaderSize);
+  mScore = mMain + kCapacity * kRowFloats[0];
+  mTrick = mScore + kCapacity * kRowFloats[1];
+  mMoon = mTrick + kCapacity * kRowFloats[2];
+}
+
+uint64_t ReplayBuffer::Size() const
+{
+  const uint64_t committed = Committed();
+  return committed < Capacity() ? committed : Capacity();
+}
+
+void ReplayBuffer::Append(const FloatMatrix& mainData, const FloatVector& scoreData, const FloatVector& trickData
+                        , const FloatMatrix& moonData)
+{
+  assert(mainData.size() == kRowFloats[0]);
+  assert(scoreData.size() == kRowFloats[1]);
+  assert(trickData.size() == kRowFloats[2]);
+  assert(moonData.size() == kRowFloats[3]);
+
+  const uint64_t index = mHeader->reserved.fetch_add(1, std::memory_order_acq_rel);
+  const uint64_t slot = Slot(index);
+  memcpy(mMain + slot * kRowFloats[0], mainData.data(), kRowFloats[0] * sizeof(float));
+  memcpy(mScore + slot * kRowFloats[1], scoreData.data(), kRowFloats[1] * sizeof(float));
+  memcpy(mTrick + slot * kRowFloats[2], trickData.data(), kRowFloats[2] * sizeof(float));
+  memcpy(mMoon + slot * kRowFloats[3], moonData.data(), kRowFloats[3] * sizeof(float));
+
+  // Publish in index order. Earlier writers are only ever a few memcpys from done, so this wait is short.
+  // (If a writer process dies between reserving and publishing, later writers will wait forever; recreate the file.)
+  uint64_t expected = index;
+  while (!mHeader->committed.compare_exchange_weak(expected, index + 1, std::memory_order_release
+                                                   , std::memory_order_relaxed)) {
+    expected = index;
+    sched_yield();
+  }
+}
+
+bool ReplayBuffer::Sample(unsigned n, const RandomGenerator& rng, uint64_t* indexes) const
+{
+  // Samples below reserved - capacity may already be partially overwritten.
+  const uint64_t committed = Committed();
+  const uint64_t reserved = mHeader->reserved.load(std::memory_order_acquire);
+  const uint64_t kCapacity = Capacity();
+  const uint64_t lowest = reserved > kCapacity ? reserved - kCapacity : 0;
+  assert(committed <= reserved);
+  if (committed <= lowest)
+    return false;
+
+  const uint64_t range = committed - lowest;
+  for (unsigned i=0; i<n; ++i)
+    indexes[i] = lowest + rng.range64(range);
+  return true;
+}
+
+bool ReplayBuffer::StillValid(uint64_t index) const
+{
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return mHeader->reserved.load(std::memory_order_acquire) <= index + Capacity();
+}
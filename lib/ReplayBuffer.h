@@ -0,0 +1,92 @@
+// lib/ReplayBuffer.h
+
+#pragma once
+
+#include "lib/KnowableState.h"
+
+#include <atomic>
+#include <string>
+
+class RandomGenerator;
+
+// A fixed-capacity ring of training samples in a memory-mapped file, shared between any number of generator
+// processes (writers) and trainers (readers).
+//
+// The file holds a one page header followed by four float32 regions, each `capacity` rows long:
+//   main  (52 x 10), score (52), trick (52), moon (52 x 3)
+// i.e. exactly the arrays WriteTrainingDataSets writes, so a row in the ring is a row of the usual dataset.
+// replaybuffer.py maps the same file with numpy.
+//
+// Samples are numbered by a monotonic 64-bit index; sample i lives in slot i % capacity.
+// A writer reserves an index with an atomic increment of `reserved`, fills the slot, waits for all earlier
+// reservations to be published, then publishes its own by advancing `committed`. Samples [0, committed) are
+// therefore complete. Readers never lock: a sample i is readable while reserved <= i + capacity, i.e. until a
+// writer reserves the index that reuses its slot. Readers check this again after copying a batch out.
+
+struct ReplayBufferHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t capacity;
+  uint32_t rowFloats[4];
+  // The number of floats per row in the main, score, trick and moon regions, for validation.
+
+  char pad[24];
+
+  std::atomic<uint64_t> reserved;
+  char pad2[56];
+  // On its own cache line: every writer increments it.
+
+  std::atomic<uint64_t> committed;
+  // The number of samples ever published.
+};
+
+class ReplayBuffer
+{
+public:
+  ~ReplayBuffer();
+
+  ReplayBuffer(const std::string& path, uint64_t capacity=0);
+    // Opens the replay buffer file at path, creating it with the given capacity if it does not exist.
+    // Processes racing to create the file all end up sharing whichever was published first.
+    // A capacity of 0 requires the file to exist. Throws std::system_error on failure.
+
+  uint64_t Capacity() const { return mHeader->capacity; }
+
+  uint64_t Committed() const { return mHeader->committed.load(std::memory_order_acquire); }
+    // The total number of samples ever published.
+
+  uint64_t Size() const;
+    // The number of samples currently held, at most Capacity().
+
+  void Append(const FloatMatrix& mainData, const FloatVector& scoreData, const FloatVector& trickData
+            , const FloatMatrix& moonData);
+    // Writes one sample and publishes it. Safe to call concurrently from any thread or process.
+
+  bool Sample(unsigned n, const RandomGenerator& rng, uint64_t* indexes) const;
+    // Fills indexes with n sample indexes chosen uniformly (with replacement) from the published samples still in
+    // the ring. Returns false, leaving indexes untouched, if there are none. Use Slot() to locate the rows.
+
+  bool StillValid(uint64_t index) const;
+    // True if sample index has not been (and is not being) overwritten. Check after reading its rows.
+
+  uint64_t Slot(uint64_t index) const { return index % mHeader->capacity; }
+
+  const float* MainData(uint64_t slot) const { return mMain + slot * KnowableState::kNumFeatures; }
+  const float* ScoreData(uint64_t slot) const { return mScore + slot * kCardsPerDeck; }
+  const float* TrickData(uint64_t slot) const { return mTrick + slot * kCardsPerDeck; }
+  const float* MoonData(uint64_t slot) const { return mMoon + slot * kCardsPerDeck * 3; }
+
+private:
+  ReplayBuffer(const ReplayBuffer&);  // unimplemented
+
+  size_t mSize;
+    // The size of the mapping, i.e. the file.
+
+  ReplayBufferHeader* mHeader;
+  float* mMain;
+  float* mScore;
+  float* mTrick;
+  float* mMoon;
+};
@@ -1,6 +1,8 @@
 #include "lib/Semaphore.h"
 #include "dlib/logger.h"
 
+#include <chrono>
+
 using namespace dlib;
 
 static logger dlog("Semaphore");
@@ -13,7 +15,6 @@ Semaphore::Semaphore(unsigned initial)
 , mMutex()
 , mSignaler(mMutex)
 {
-  assert(false);
   dlog.set_level(LALL);
 }
 
@@ -72,9 +73,15 @@ unsigned Semaphore::DrainOrTimeout(unsigned long milliseconds)
 
 unsigned Semaphore::WaitFor(unsigned count, unsigned long milliseconds)
 {
+  // Each Release wakes the signaler, so wait for what remains of the timeout rather than all of it again.
+  using namespace std::chrono;
+  const auto deadline = steady_clock::now() + std::chrono::milliseconds(milliseconds);
   auto_mutex locker(mMutex);
-  while (mValue<count && mSignaler.wait_or_timeout(milliseconds))
-  {}
+  while (mValue<count) {
+    const auto remaining = ceil<std::chrono::milliseconds>(deadline - steady_clock::now()).count();
+    if (remaining <= 0 || !mSignaler.wait_or_timeout(remaining))
+      break;
+  }
   unsigned result = mValue;
   mValue = 0;
   return result;
@@ -0,0 +1,63 @@
+// lib/Sprt.cpp
+
+#include "lib/Sprt.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+Sprt::Sprt(double s0, double s1, double alpha, double beta, int minSamples)
+    : mS0(s0)
+    , mS1(s1)
+    , mLower(log(beta / (1.0 - alpha)))
+    , mUpper(log((1.0 - beta) / alpha))
+    , mMinSamples(minSamples < 2 ? 2 : minSamples)
+    , mCount(0)
+    , mMean(0.0)
+    , mM2(0.0)
+    , mDecision(kContinue)
+{
+    assert(s0 != s1);
+    assert(alpha > 0.0 && alpha < 1.0);
+    assert(beta > 0.0 && beta < 1.0);
+}
+
+Sprt::Decision Sprt::Add(double x)
+{
+    ++mCount;
+    const double delta = x - mMean;
+    mMean += delta / mCount;
+    mM2 += delta * (x - mMean);
+
+    if (mDecision == kContinue && mCount >= mMinSamples)
+    {
+        const double llr = LLR();
+        if (llr >= mUpper)
+            mDecision = kAcceptH1;
+        else if (llr <= mLower)
+            mDecision = kAcceptH0;
+    }
+    return mDecision;
+}
+
+double Sprt::Mean() const { return mMean; }
+
+double Sprt::Variance() const { return mCount < 2 ? 0.0 : mM2 / (mCount - 1); }
+
+double Sprt::LLR() const
+{
+    // For normal samples with known variance v, the log likelihood ratio of mean s1 over mean s0 is
+    //   sum((x - s0)^2 - (x - s1)^2) / 2v = n (s1 - s0) (2 xbar - s0 - s1) / 2v
+    const double variance = Variance();
+    if (variance <= 0.0)
+        return 0.0;
+    return mCount * (mS1 - mS0) * (2.0 * mMean - mS0 - mS1) / (2.0 * variance);
+}
+
+void Sprt::Summarize() const
+{
+    const char* result[3] = {"undecided", "H0 accepted", "H1 accepted"};
+    const double stderror = mCount < 2 ? 0.0 : sqrt(Variance() / mCount);
+    printf("SPRT [%4.2f, %4.2f]: %s after %d matches, LLR %4.2f in (%4.2f, %4.2f), mean %4.3f +- %4.3f\n", mS0, mS1,
+        result[mDecision], mCount, LLR(), mLower, mUpper, mMean, 1.96 * stderror);
+}
@@ -0,0 +1,58 @@
+// lib/Sprt.h
+
+#pragma once
+
+// A sequential probability ratio test on the mean of a stream of paired differences.
+// In a tournament each sample is one match: the champion's advantage over the opponent, in points per game
+// (positive means the champion took fewer points). The six seatings of a match already cancel most of the
+// luck of the deal, so matches are close to independent, roughly normal samples.
+//
+// The test decides between H0: mean == s0 and H1: mean == s1 (normally s0 < s1), with false positive rate
+// alpha and false negative rate beta. The variance is estimated from the samples (the usual GSPRT
+// approximation), so no decision is made before a minimum number of samples.
+
+class Sprt
+{
+public:
+    enum Decision
+    {
+        kContinue,
+        kAcceptH0,
+        kAcceptH1,
+    };
+
+    Sprt(double s0, double s1, double alpha = 0.05, double beta = 0.05, int minSamples = 20);
+
+    Decision Add(double x);
+    // Adds one sample and returns the decision so far. Once made, a decision does not change.
+
+    Decision Result() const { return mDecision; }
+
+    int Count() const { return mCount; }
+    double Mean() const;
+    double Variance() const;
+    // The unbiased sample variance
+
+    double LLR() const;
+    // The log likelihood ratio of H1 over H0 for the samples so far.
+
+    double LowerBound() const { return mLower; }
+    double UpperBound() const { return mUpper; }
+    // H0 is accepted when the LLR falls to LowerBound(), H1 when it rises to UpperBound().
+
+    void Summarize() const;
+
+private:
+    const double mS0;
+    const double mS1;
+    const double mLower;
+    const double mUpper;
+    const int mMinSamples;
+
+    int mCount;
+    double mMean;
+    double mM2;
+    // Welford's running mean and sum of squared deviations
+
+    Decision mDecision;
+};
@@ -10,6 +10,18 @@ Strategy::Strategy(const AnnotatorPtr& annotator)
     : mAnnotator(annotator)
 {}
 
+Card Strategy::choosePlayBy(const KnowableState& state, const RandomGenerator& rng, double) const
+{
+    return choosePlay(state, rng);
+}
+
+Card Strategy::ponderPlay(const KnowableState& state, const RandomGenerator& rng, const std::atomic<bool>&) const
+{
+    return choosePlay(state, rng);
+}
+
+std::string Strategy::Fingerprint() const { return std::string(); }
+
 StrategyPtr loadIntuition(const std::string& intuitionNameOrPath)
 {
     if (intuitionNameOrPath == "random")
@@ -36,7 +48,7 @@ std::vector<std::string> split(const std::string& s, char delimiter = ' ')
     return tokens;
 }
 
-StrategyPtr makePlayer(const std::string& intuitionName, int rollouts)
+StrategyPtr makePlayer(const std::string& intuitionName, int rollouts, double moveBudget)
 {
     StrategyPtr intuition = loadIntuition(intuitionName);
     if (rollouts == 0)
@@ -47,7 +59,9 @@ StrategyPtr makePlayer(const std::string& intuitionName, int rollouts)
     {
         AnnotatorPtr kNoAnnotator(0);
         const bool kParallel = true;
-        return StrategyPtr(new MonteCarlo(intuition, rollouts, kParallel, kNoAnnotator));
+        MonteCarlo* monteCarlo = new MonteCarlo(intuition, rollouts, kParallel, kNoAnnotator);
+        monteCarlo->SetMoveBudget(moveBudget);
+        return StrategyPtr(monteCarlo);
     }
 }
 
@@ -57,16 +71,26 @@ StrategyPtr makePlayer(const std::string& arg)
 
     std::string intuitionName;
     int rollouts;
+    double moveBudget = 0.0;
+
+    std::string spec = arg;
+    const size_t at = spec.find('@');
+    if (at != std::string::npos)
+    {
+        moveBudget = std::stod(spec.substr(at + 1));
+        assert(moveBudget > 0.0);
+        spec = spec.substr(0, at);
+    }
 
     const char kSep = '#';
-    if (arg[arg.size() - 1] == kSep)
+    if (spec[spec.size() - 1] == kSep)
     {
-        intuitionName = arg.substr(0, arg.size() - 1);
+        intuitionName = spec.substr(0, spec.size() - 1);
         rollouts = kDefaultRollouts;
     }
     else
     {
-        std::vector<std::string> parts = split(arg, '#');
+        std::vector<std::string> parts = split(spec, '#');
         assert(parts.size() > 0);
         assert(parts.size() <= 2);
 
@@ -81,5 +105,6 @@ StrategyPtr makePlayer(const std::string& arg)
             rollouts = std::stoi(parts[1]);
         }
     }
-    return makePlayer(intuitionName, rollouts);
+    assert(rollouts > 0 || moveBudget == 0.0);
+    return makePlayer(intuitionName, rollouts, moveBudget);
 }
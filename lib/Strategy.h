@@ -4,7 +4,9 @@
 #include "lib/Card.h"
 #include "lib/CardArray.h"
 
+#include <atomic>
 #include <memory>
+#include <string>
 
 class KnowableState;
 class Strategy;
@@ -19,14 +21,32 @@ public:
 
     virtual Card choosePlay(const KnowableState& state, const RandomGenerator& rng) const = 0;
 
+    virtual Card choosePlayBy(const KnowableState& state, const RandomGenerator& rng, double deadline) const;
+    // Chooses a play, returning by the wall-clock deadline (in the units of now()) if the strategy can trade quality
+    // for time, as MonteCarlo can. The default ignores the deadline and calls choosePlay.
+
+    virtual Card ponderPlay(
+        const KnowableState& state, const RandomGenerator& rng, const std::atomic<bool>& cancelled) const;
+    // Chooses a play speculatively, e.g. for a position that may arise after an opponent moves. It runs only in the
+    // calling thread, so it can be given a low priority without holding up other searches, and it may give up early
+    // once cancelled is set. The default calls choosePlay.
+
     virtual Card predictOutcomes(
         const KnowableState& state, const RandomGenerator& rng, float playExpectedValue[13]) const = 0;
 
     AnnotatorPtr getAnnotator() const { return mAnnotator; }
 
+    virtual std::string Fingerprint() const;
+    // A strategy whose plays depend only on the knowable state, and never on the random generator, returns a string
+    // that identifies it and everything its plays depend on (e.g. the model's content). Two strategies with the
+    // same fingerprint must play identically. Everything else returns the empty string (the default).
+    // See OutcomeCache.
+
 private:
     const AnnotatorPtr mAnnotator;
 };
 
-StrategyPtr makePlayer(const std::string& intuitionName, int rollouts);
+StrategyPtr makePlayer(const std::string& intuitionName, int rollouts, double moveBudget = 0.0);
 StrategyPtr makePlayer(const std::string& arg);
+// arg is <intuition>[#[<rollouts>][@<seconds>]], e.g. random#100, or random#1000@0.25 for MonteCarlo with at most
+// 1000 alternates per move and a per-move time budget of a quarter second.
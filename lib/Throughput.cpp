@@ -0,0 +1,114 @@
+// lib/Throughput.cpp
+
+#include "lib/Throughput.h"
+#include "lib/timer.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+MetricCounter gDecisions("decisions");
+MetricCounter gRollouts("rollouts");
+MetricCounter gInferences("inferences");
+
+long PeakRssKilobytes()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+static std::string jsonString(const std::string& s)
+{
+    std::string quoted = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            quoted += '\\';
+        if ((unsigned char) c < 0x20)
+            c = ' ';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+ThroughputReport::ThroughputReport(const std::string& program)
+    : mProgram(program)
+    , mStart(0.0)
+    , mSeconds(0.0)
+    , mGames(0)
+    , mDecisions(0)
+    , mRollouts(0)
+    , mInferences(0)
+{
+}
+
+void ThroughputReport::Config(const std::string& key, const std::string& value)
+{
+    mConfig.emplace_back(key, jsonString(value));
+}
+
+void ThroughputReport::Config(const std::string& key, uint64_t value)
+{
+    mConfig.emplace_back(key, std::to_string(value));
+}
+
+void ThroughputReport::Start()
+{
+    mDecisions = gDecisions.Read();
+    mRollouts = gRollouts.Read();
+    mInferences = gInferences.Read();
+    mStart = now();
+}
+
+void ThroughputReport::Finish(uint64_t games)
+{
+    mSeconds = delta(mStart);
+    mGames = games;
+    mDecisions = gDecisions.Read() - mDecisions;
+    mRollouts = gRollouts.Read() - mRollouts;
+    mInferences = gInferences.Read() - mInferences;
+}
+
+void ThroughputReport::Write(FILE* out) const
+{
+    const double seconds = mSeconds > 0.0 ? mSeconds : 1e-9;
+    fprintf(out, "{\n  \"program\": %s,\n  \"config\": {", jsonString(mProgram).c_str());
+    for (size_t i = 0; i < mConfig.size(); ++i)
+        fprintf(out, "%s%s: %s", i == 0 ? "" : ", ", jsonString(mConfig[i].first).c_str(), mConfig[i].second.c_str());
+    fprintf(out, "},\n");
+    fprintf(out, "  \"seconds\": %.3f,\n", mSeconds);
+    fprintf(out, "  \"games\": %llu,\n", (unsigned long long) mGames);
+    fprintf(out, "  \"decisions\": %llu,\n", (unsigned long long) mDecisions);
+    fprintf(out, "  \"rollouts\": %llu,\n", (unsigned long long) mRollouts);
+    fprintf(out, "  \"inferences\": %llu,\n", (unsigned long long) mInferences);
+    fprintf(out, "  \"games_per_sec\": %.3f,\n", mGames / seconds);
+    fprintf(out, "  \"decisions_per_sec\": %.1f,\n", mDecisions / seconds);
+    fprintf(out, "  \"rollouts_per_sec\": %.1f,\n", mRollouts / seconds);
+    fprintf(out, "  \"inferences_per_sec\": %.1f,\n", mInferences / seconds);
+    fprintf(out, "  \"peak_rss_kb\": %ld\n}\n", PeakRssKilobytes());
+    fflush(out);
+}
+
+void ThroughputReport::Write(const char* path) const
+{
+    if (path == nullptr || strcmp(path, "-") == 0)
+    {
+        Write(stdout);
+        return;
+    }
+    FILE* out = fopen(path, "w");
+    if (out == nullptr)
+    {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    Write(out);
+    fclose(out);
+}
@@ -0,0 +1,58 @@
+// lib/Throughput.h
+
+#pragma once
+
+#include "lib/Metrics.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Process wide counts of the engine's units of work, for end to end throughput reports such as the --benchmark
+// modes of hearts and tournament. They are sharded metrics, since rollouts are counted from every thread.
+
+extern MetricCounter gDecisions;
+// Plays chosen by a strategy in GameState::PlayGame, i.e. not forced.
+extern MetricCounter gRollouts;
+// Games played out by GameState::PlayOutGameMonteCarlo.
+extern MetricCounter gInferences;
+// Positions evaluated by a DnnModelIntuition.
+
+long PeakRssKilobytes();
+// The peak resident set size of this process so far.
+
+// Measures the work done between Start() and Finish() and writes it as a JSON object, e.g.
+//   {"program": "hearts", "config": {"intuition": "random", ...}, "games": 64, "seconds": 12.5,
+//    "games_per_sec": 5.12, "decisions_per_sec": ..., "rollouts_per_sec": ..., "inferences_per_sec": ...,
+//    "peak_rss_kb": 10240}
+// The config describes the fixed workload, so that reports are only compared for the same workload.
+
+class ThroughputReport
+{
+public:
+    ThroughputReport(const std::string& program);
+
+    void Config(const std::string& key, const std::string& value);
+    void Config(const std::string& key, uint64_t value);
+
+    void Start();
+    void Finish(uint64_t games);
+
+    void Write(FILE* out) const;
+    void Write(const char* path) const;
+    // Writes to the file at path, or to stdout when path is null or "-". Exits with a message on failure.
+
+private:
+    const std::string mProgram;
+    std::vector<std::pair<std::string, std::string>> mConfig;
+    // The values are JSON encoded.
+
+    double mStart;
+    double mSeconds;
+    uint64_t mGames;
+    uint64_t mDecisions;
+    uint64_t mRollouts;
+    uint64_t mInferences;
+};
@@ -2,58 +2,96 @@
 
 #include "lib/Tournament.h"
 #include "lib/GameState.h"
+#include "lib/OutcomeCache.h"
+
+#include <atomic>
+#include <errno.h>
+#include <future>
+#include <string.h>
+#include <vector>
 
 typedef StrategyPtr Player;
 typedef StrategyPtr Table[4];
 
+void Tournament::MakeSeatings(StrategyPtr champion, StrategyPtr opponent, Table match[6])
+{
+    // A match is six games with the same deal of cards to the four positions (N, E, S, W)
+    // The two player strategies each occupy two of the table positions.
+    // There are six unique arrangements of the two player strategies.
+    const StrategyPtr c = champion;
+    const StrategyPtr o = opponent;
+    const Table seatings[6] = {
+        {c, c, o, o},
+        {c, o, c, o},
+        {c, o, o, c},
+        {o, o, c, c},
+        {o, c, o, c},
+        {o, c, c, o},
+    };
+    for (int i = 0; i < 6; ++i)
+        for (int j = 0; j < 4; ++j)
+            match[i][j] = seatings[i][j];
+}
+
 Tournament::Tournament(StrategyPtr champion, StrategyPtr opponent, bool quiet, bool saveMoonDeals)
     : mChampion(champion)
     , mOpponent(opponent)
     , mQuiet(quiet)
     , mSaveMoonDeals(saveMoonDeals)
+    , mSprt(nullptr)
+    , mCache(nullptr)
+    , mFirstMatch(0)
 {}
 
-void Tournament::runOneGame(uint128_t dealIndex, StrategyPtr players[4], Scores& scores, bool& moon)
+GameOutcome Tournament::playGame(uint128_t dealIndex, StrategyPtr players[4], const RandomGenerator& rng)
 {
+    if (mCache != nullptr)
+        return mCache->PlayGame(dealIndex, players, rng);
     Deal deck(dealIndex);
     GameState state(deck);
-    GameOutcome outcome = state.PlayGame(players, mRng);
-    moon = outcome.shotTheMoon();
+    return state.PlayGame(players, rng);
+}
 
-    const char* name[2] = {"c", "o"};
+void Tournament::runOneGame(uint128_t dealIndex, StrategyPtr players[4], Scores& scores, bool& moon)
+{
+    GameOutcome outcome = playGame(dealIndex, players, mRng);
+    moon = outcome.shotTheMoon();
 
     scores.Accumulate(players, outcome);
 
     if (!mQuiet)
+        printGame(players, outcome);
+}
+
+void Tournament::printGame(StrategyPtr players[4], const GameOutcome& outcome) const
+{
+    const char* name[2] = {"c", "o"};
+    for (int i = 0; i < 4; ++i)
     {
-        for (int i = 0; i < 4; ++i)
-        {
-            StrategyPtr player = players[i];
-            int playerIndex = player == mChampion ? 0 : 1;
-            printf("%s=%5.1f ", name[playerIndex], outcome.ZeroMeanStandardScore(i));
-        }
-        if (moon)
-            printf("  Shot the moon!\n");
-        else
-            printf("\n");
+        StrategyPtr player = players[i];
+        int playerIndex = player == mChampion ? 0 : 1;
+        printf("%s=%5.1f ", name[playerIndex], outcome.ZeroMeanStandardScore(i));
     }
+    if (outcome.shotTheMoon())
+        printf("  Shot the moon!\n");
+    else
+        printf("\n");
 }
 
-void Tournament::runOneMatch(const uint128_t dealIndex, float playerScores[2])
+static void saveMoonDeal(uint128_t dealIndex)
+{
+    std::string hex = asHexString(dealIndex);
+    FILE* f = fopen("moonhands.txt", "a");
+    fprintf(f, "%s\n", hex.c_str());
+    fclose(f);
+}
+
+Scores Tournament::runOneMatch(const uint128_t dealIndex, float playerScores[2])
 {
 
-    // A match is six games with the same deal of cards to the four positions (N, E, S, W)
-    // The two player strategies each occupy two of the table positions.
-    // There are six unique arrangements of the two player strategies.
     // We'll rollup all of the game scores into one score for each strategy.
-    Table match[6] = {
-        {mChampion, mChampion, mOpponent, mOpponent},
-        {mChampion, mOpponent, mChampion, mOpponent},
-        {mChampion, mOpponent, mOpponent, mChampion},
-        {mOpponent, mOpponent, mChampion, mChampion},
-        {mOpponent, mChampion, mOpponent, mChampion},
-        {mOpponent, mChampion, mChampion, mOpponent},
-    };
+    Table match[6];
+    MakeSeatings(mChampion, mOpponent, match);
 
     Scores matchScores(mChampion);
 
@@ -84,21 +122,156 @@ void Tournament::runOneMatch(const uint128_t dealIndex, float playerScores[2])
         playerScores[p] += matchScores.mPlayer[p];
 
     if (mSaveMoonDeals && shotMoon > 1)
+        saveMoonDeal(dealIndex);
+
+    return matchScores;
+}
+
+float Tournament::runOneTournament(int numMatches, const uint128_t* deals)
+{
+    float playerScores[2] = {0};
+    mAdvantages.clear();
+
+    int played = 0;
+    for (int i = 0; i < numMatches; ++i)
     {
-        std::string hex = asHexString(dealIndex);
-        FILE* f = fopen("moonhands.txt", "a");
-        fprintf(f, "%s\n", hex.c_str());
-        fclose(f);
+        const Scores matchScores = runOneMatch(deals[i], playerScores);
+        ++played;
+
+        const double advantage = matchScores.ChampionAdvantage();
+        mAdvantages.push_back(advantage);
+        if (mSprt != nullptr && mSprt->Add(advantage) != Sprt::kContinue)
+            break;
     }
+
+    return finishTournament(played, playerScores);
+}
+
+uint64_t Tournament::GameStream(int match, int seating)
+{
+    // Philox streams of one seed are independent, so numbering the games is enough.
+    return uint64_t(match) * 6 + seating;
 }
 
-float Tournament::runOneTournament(int numMatches, uint128_t* deals)
+float Tournament::runParallelTournament(
+    int numMatches, const uint128_t* deals, int numThreads, uint64_t seed, const char* resultsPath)
 {
+    assert(numThreads >= 1);
+
+    Table match[6];
+    MakeSeatings(mChampion, mOpponent, match);
+
+    FILE* results = nullptr;
+    if (resultsPath != nullptr)
+    {
+        results = fopen(resultsPath, "a");
+        if (results == nullptr)
+        {
+            fprintf(stderr, "fopen %s failed: %s\n", resultsPath, strerror(errno));
+            exit(1);
+        }
+    }
+
+    // Shared state, all guarded by `lock` except the job counter.
+    std::atomic<int> nextJob(0);
+    dlib::mutex lock;
+    std::vector<Scores> matchScores(numMatches, Scores(mChampion));
+    std::vector<int> gamesDone(numMatches, 0);
+    std::vector<int> moonGames(numMatches, 0);
     float playerScores[2] = {0};
+    int matchesCounted = 0;
+    bool stopped = false;
 
-    for (int i = 0; i < numMatches; ++i)
+    mAdvantages.clear();
+
+    const int kNumJobs = numMatches * 6;
+    auto worker = [&]() -> int {
+        int played = 0;
+        for (int job = nextJob++; job < kNumJobs; job = nextJob++)
+        {
+            const int m = job / 6;
+            const int seating = job % 6;
+            const RandomGenerator rng(seed, GameStream(mFirstMatch + m, seating));
+
+            GameOutcome outcome = playGame(deals[m], match[seating], rng);
+            ++played;
+
+            dlib::auto_mutex guard(lock);
+            matchScores[m].Accumulate(match[seating], outcome);
+            if (outcome.shotTheMoon())
+                ++moonGames[m];
+            if (results != nullptr)
+            {
+                fprintf(results, "%d\t%d\t%s\t%llu", mFirstMatch + m, seating, asHexString(deals[m]).c_str(),
+                    (unsigned long long) seed);
+                for (int i = 0; i < 4; ++i)
+                {
+                    const char* role = match[seating][i] == mChampion ? "c" : "o";
+                    fprintf(results, "\t%s=%.1f", role, outcome.ZeroMeanStandardScore(i));
+                }
+                fprintf(results, "\t%d\n", outcome.shotTheMoon() ? 1 : 0);
+                fflush(results);
+            }
+            if (!mQuiet)
+                printGame(match[seating], outcome);
+
+            if (++gamesDone[m] == 6)
+            {
+                if (!mQuiet)
+                {
+                    printf("Match %d %s", mFirstMatch + m, asHexString(deals[m]).c_str());
+                    matchScores[m].Summarize();
+                }
+                if (mSaveMoonDeals && moonGames[m] > 1)
+                    saveMoonDeal(deals[m]);
+            }
+
+            // Completed matches are counted in match order, so that an early stop is reproducible too.
+            while (!stopped && matchesCounted < numMatches && gamesDone[matchesCounted] == 6)
+            {
+                const Scores& counted = matchScores[matchesCounted++];
+                for (int p = 0; p < 2; ++p)
+                    playerScores[p] += counted.mPlayer[p];
+                mAdvantages.push_back(counted.ChampionAdvantage());
+                if (mSprt != nullptr && mSprt->Add(counted.ChampionAdvantage()) != Sprt::kContinue)
+                {
+                    // Games already in flight finish, but no new ones start.
+                    stopped = true;
+                    nextJob = kNumJobs;
+                }
+            }
+        }
+        return played;
+    };
+
+    dlib::thread_pool pool(numThreads);
+    std::vector<std::future<int>> workers(numThreads);
+    for (int i = 0; i < numThreads; ++i)
+        workers[i] = dlib::async(pool, worker);
+    for (int i = 0; i < numThreads; ++i)
+        workers[i].get();
+
+    if (results != nullptr)
+        fclose(results);
+
+    return finishTournament(matchesCounted, playerScores);
+}
+
+float Tournament::finishTournament(int numMatches, const float playerScores[2]) const
+{
+    if (mSprt != nullptr)
+        mSprt->Summarize();
+
+    if (mCache != nullptr)
+        printf("Outcome cache: %llu hits, %llu misses\n", (unsigned long long) mCache->Hits(),
+            (unsigned long long) mCache->Misses());
+
+    if (numMatches == 0)
     {
-        runOneMatch(deals[i], playerScores);
+        // e.g. an empty shard. Scores are zero mean, so report an even result.
+        if (!mQuiet)
+            printf("No matches played\n");
+        return 0.0;
     }
 
     if (!mQuiet)
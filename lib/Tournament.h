@@ -3,9 +3,13 @@
 #pragma once
 
 #include "lib/GameOutcome.h"
+#include "lib/Sprt.h"
 #include "lib/Strategy.h"
 #include "lib/random.h"
 
+#include <vector>
+
+class OutcomeCache;
 struct Scores;
 
 class Tournament
@@ -13,18 +17,59 @@ class Tournament
 public:
     Tournament(StrategyPtr champion, StrategyPtr opponent, bool quiet = false, bool saveMoonDeals = false);
 
-    float runOneTournament(int numMatches = 1, uint128_t* gDeals = nullptr);
+    float runOneTournament(int numMatches = 1, const uint128_t* gDeals = nullptr);
 
-    void runOneMatch(const uint128_t dealIndex, float playerScores[2]);
+    Scores runOneMatch(const uint128_t dealIndex, float playerScores[2]);
+    // Adds the match's scores to playerScores, and returns them.
 
     void runOneGame(uint128_t dealIndex, StrategyPtr players[4], Scores& scores, bool& moon);
 
+    float runParallelTournament(int numMatches, const uint128_t* deals, int numThreads, uint64_t seed,
+        const char* resultsPath = nullptr);
+    // Plays the same games as runOneTournament, but each (deal, seating) game is an independent job spread across
+    // numThreads workers. Every game plays with its own RandomGenerator, stream GameStream(match, seating) of the
+    // seed, so the results do not depend on the number of threads or on scheduling, as long as the strategies only
+    // draw randomness from the generator they are given.
+    // Games are folded into their match's Scores as they complete. When resultsPath is given, one tab separated
+    // line per game (match, seating, deal, seed, scores, moon) is appended to it as each game completes.
+
+    static uint64_t GameStream(int match, int seating);
+    // The RandomGenerator stream of a game of a seeded tournament.
+
+    static void MakeSeatings(StrategyPtr champion, StrategyPtr opponent, StrategyPtr match[6][4]);
+    // The six arrangements of two strategies, each in two of the four seats, that make up a match.
+
+    void setStoppingRule(Sprt* sprt) { mSprt = sprt; }
+    // When set, each completed match's Scores::ChampionAdvantage() is added to the test, and the tournament stops
+    // as soon as it decides. The return value and summary then cover only the matches played.
+
+    void setFirstMatch(int firstMatch) { mFirstMatch = firstMatch; }
+    // The number of the first match in a slice of a larger corpus, so that the matches of every shard keep the
+    // numbers (and so the game seeds) they have when the whole corpus is played.
+
+    void setOutcomeCache(OutcomeCache* cache) { mCache = cache; }
+    // When set, games between deterministic strategies are looked up in (and added to) the cache instead of being
+    // played every time.
+
+    const std::vector<double>& matchAdvantages() const { return mAdvantages; }
+    // Scores::ChampionAdvantage() of each match counted by the last run, in match order.
+
 private:
+    GameOutcome playGame(uint128_t dealIndex, StrategyPtr players[4], const RandomGenerator& rng);
+
+    void printGame(StrategyPtr players[4], const GameOutcome& outcome) const;
+
+    float finishTournament(int numMatches, const float playerScores[2]) const;
+
     StrategyPtr mChampion;
     StrategyPtr mOpponent;
     bool mQuiet;
     bool mSaveMoonDeals;
     RandomGenerator mRng;
+    Sprt* mSprt;
+    OutcomeCache* mCache;
+    int mFirstMatch;
+    std::vector<double> mAdvantages;
 };
 
 // This Scores struct is useful for analyzing the results of one match.
@@ -57,6 +102,12 @@ struct Scores
         }
     }
 
+    double ChampionAdvantage() const
+    {
+        // Points per game per seat the champion took fewer of than the opponent, over the six games.
+        return (mPlayer[1] - mPlayer[0]) / 12.0;
+    }
+
     void Summarize() const
     {
         const char* name[2] = {"c", "o"};
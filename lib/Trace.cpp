@@ -0,0 +1,145 @@
+// lib/Trace.cpp
+
+#include "lib/Trace.h"
+
+#include <errno.h>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+std::atomic<bool> gTracing(false);
+
+static uint64_t gTraceStartTicks = 0;
+static std::string gTracePath;
+
+struct TraceEvent
+{
+    const char* name;
+    const char* argName;
+    uint64_t start;
+    uint64_t end;
+    int64_t arg;
+};
+
+// The spans of one thread. Only the owning thread appends, publishing each span with a release store of the
+// count, so WriteTrace can read the spans published so far while the thread goes on tracing. Spans are kept in
+// chunks that are never moved or freed.
+class TraceBuffer
+{
+public:
+    static const size_t kChunkEvents = 1 << 14;
+    static const size_t kMaxChunks = 1024;
+
+    TraceBuffer(unsigned tid) : mTid(tid), mCount(0), mDropped(0) { memset(mChunks, 0, sizeof(mChunks)); }
+
+    void Append(const TraceEvent& event)
+    {
+        const size_t i = mCount.load(std::memory_order_relaxed);
+        const size_t chunk = i / kChunkEvents;
+        if (chunk >= kMaxChunks)
+        {
+            mDropped.store(mDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        if (mChunks[chunk] == nullptr)
+            mChunks[chunk] = new TraceEvent[kChunkEvents];
+        mChunks[chunk][i % kChunkEvents] = event;
+        mCount.store(i + 1, std::memory_order_release);
+    }
+
+    unsigned Tid() const { return mTid; }
+    size_t Count() const { return mCount.load(std::memory_order_acquire); }
+    uint64_t Dropped() const { return mDropped.load(std::memory_order_relaxed); }
+    const TraceEvent& Event(size_t i) const { return mChunks[i / kChunkEvents][i % kChunkEvents]; }
+
+private:
+    const unsigned mTid;
+    std::atomic<size_t> mCount;
+    std::atomic<uint64_t> mDropped;
+    TraceEvent* mChunks[kMaxChunks];
+};
+
+// Buffers outlive their threads (e.g. a thread pool's) until the trace is written, so they are never freed.
+static std::mutex gBuffersMutex;
+static std::vector<TraceBuffer*>* gBuffers = new std::vector<TraceBuffer*>;
+
+static TraceBuffer* threadBuffer()
+{
+    thread_local TraceBuffer* buffer = nullptr;
+    if (buffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(gBuffersMutex);
+        buffer = new TraceBuffer(gBuffers->size());
+        gBuffers->push_back(buffer);
+    }
+    return buffer;
+}
+
+void RecordTraceSpan(const char* name, uint64_t startTicks, uint64_t endTicks, const char* argName, int64_t arg)
+{
+    threadBuffer()->Append(TraceEvent{name, argName, startTicks, endTicks, arg});
+}
+
+static void writeTraceAtExit() { WriteTrace(gTracePath.c_str()); }
+
+void StartTracing(const char* path)
+{
+    if (gTracing)
+        return;
+    gTracePath = path;
+    gTraceStartTicks = ReadTicks();
+    threadBuffer(); // the calling thread is thread 0
+    gTracing.store(true);
+    atexit(writeTraceAtExit);
+}
+
+void WriteTrace(const char* path)
+{
+    FILE* out = fopen(path, "w");
+    if (out == nullptr)
+    {
+        fprintf(stderr, "Cannot write trace %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    std::vector<TraceBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(gBuffersMutex);
+        buffers = *gBuffers;
+    }
+
+    const double micros = 1.0e6 * SecondsPerTick();
+    const int pid = getpid();
+    uint64_t dropped = 0;
+    bool first = true;
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (const TraceBuffer* buffer : buffers)
+    {
+        fprintf(out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %u, "
+                     "\"args\": {\"name\": \"%s %u\"}}",
+            first ? "" : ",\n", pid, buffer->Tid(), buffer->Tid() == 0 ? "main" : "thread", buffer->Tid());
+        first = false;
+
+        const size_t count = buffer->Count();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const TraceEvent& event = buffer->Event(i);
+            const double ts = micros * int64_t(event.start - gTraceStartTicks);
+            const double dur = micros * (event.end - event.start);
+            fprintf(out, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f",
+                event.name, pid, buffer->Tid(), ts, dur);
+            if (event.argName != nullptr)
+                fprintf(out, ", \"args\": {\"%s\": %lld}", event.argName, (long long) event.arg);
+            fprintf(out, "}");
+        }
+        dropped += buffer->Dropped();
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+
+    if (dropped > 0)
+        fprintf(stderr, "The trace buffers were full, %llu spans were dropped\n", (unsigned long long) dropped);
+}
@@ -0,0 +1,61 @@
+// lib/Trace.h
+
+#pragma once
+
+#include "lib/Metrics.h"
+
+#include <atomic>
+#include <stdint.h>
+
+// Optional tracing of where threads spend their time, written as Chrome trace event JSON that chrome://tracing
+// and Perfetto (ui.perfetto.dev) show as a timeline with one track per thread. Meant for finding idle gaps,
+// barrier waits and batching stalls that totals such as lib/Metrics.h cannot show.
+//
+//   { TraceSpan span("MonteCarlo::choosePlay"); ... }
+//
+// Tracing is off unless StartTracing is called, and a span then costs one predictable branch. When on, each
+// thread appends its completed spans to its own buffer without locks or atomic read-modify-writes, and all the
+// buffers are written out when the process exits.
+
+extern std::atomic<bool> gTracing;
+
+void StartTracing(const char* path);
+// Turns tracing on and arranges for the trace to be written to path at exit. Spans already begun are not traced.
+
+void WriteTrace(const char* path);
+// Writes the spans traced so far. StartTracing arranges for this at exit.
+
+void RecordTraceSpan(const char* name, uint64_t startTicks, uint64_t endTicks, const char* argName, int64_t arg);
+// Records a span of the calling thread. The name and argName must be string literals (or otherwise outlive the
+// process), since only the pointers are kept.
+
+class TraceSpan
+{
+public:
+    TraceSpan(const char* name)
+        : mName(name)
+        , mStart(gTracing.load(std::memory_order_relaxed) ? ReadTicks() : 0)
+        , mArgName(nullptr)
+        , mArg(0)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if (mStart != 0)
+            RecordTraceSpan(mName, mStart, ReadTicks(), mArgName, mArg);
+    }
+
+    void SetArg(const char* name, int64_t value)
+    {
+        mArgName = name;
+        mArg = value;
+    }
+    // One value to show with the span, e.g. a batch size.
+
+private:
+    const char* mName;
+    const uint64_t mStart;
+    const char* mArgName;
+    int64_t mArg;
+};
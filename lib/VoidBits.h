@@ -45,6 +45,8 @@ public:
 
   // bool areAnyPlayersKnownVoid() const { return mBits != 0; }
 
+  uint16_t Bits() const { return mBits; }
+
   uint8_t CountVoidInSuit(Suit suit) const;
 
   void VerifyVoids(const CardHands& hands) const;
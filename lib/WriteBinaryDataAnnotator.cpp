@@ -0,0 +1,90 @@
+// lib/WriteBinaryDataAnnotator.cpp
+
+#include "lib/WriteBinaryDataAnnotator.h"
+#include "lib/AnnotationRecord.h"
+#include "lib/KnowableState.h"
+#include "lib/PossibilityAnalyzer.h"
+#include "lib/random.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+WriteBinaryDataAnnotator::~WriteBinaryDataAnnotator()
+{
+  fclose(mFile);
+}
+
+WriteBinaryDataAnnotator::WriteBinaryDataAnnotator()
+: mHash(asHexString(RandomGenerator::Random128()))
+, mFile(0)
+{
+  const char* dataDirPath = "data";
+  int err = mkdir(dataDirPath, 0777);
+  if (err != 0 && errno != EEXIST) {
+    const char* errmsg = strerror(errno);
+    fprintf(stderr, "mkdir %s failed: %s\n", dataDirPath, errmsg);
+    exit(1);
+  }
+
+  char path[128];
+  sprintf(path, "%s/%s.rec", dataDirPath, mHash.c_str());
+  mFile = fopen(path, "w");
+  if (mFile == 0) {
+    fprintf(stderr, "fopen %s failed: %s\n", path, strerror(errno));
+    exit(1);
+  }
+
+  AnnotationFileHeader header;
+  InitAnnotationFileHeader(header);
+  fwrite(&header, sizeof(header), 1, mFile);
+}
+
+void WriteBinaryDataAnnotator::On_DnnMonteCarlo_choosePlay(const KnowableState& state
+                                  , PossibilityAnalyzer* analyzer
+                                  , const float expectedScore[13], const float moonProb[13][3])
+{
+}
+
+void WriteBinaryDataAnnotator::OnGameStateBeforePlay(const GameState& state)
+{
+}
+
+void WriteBinaryDataAnnotator::OnWriteData(const KnowableState& state, PossibilityAnalyzer* analyzer
+                          , const float expectedScore[13], const float moonProb[13][3], const float winsTrickProb[13])
+{
+  AnnotationRecord record;
+  memset(&record, 0, sizeof(record));
+  record.state = state.Pack();
+
+  const CardHand choices = state.LegalPlays();
+  record.numChoices = choices.Size();
+  CardArray::iterator it(choices);
+  for (unsigned i=0; i<choices.Size(); ++i) {
+    record.choices[i] = it.next();
+  }
+
+  const uint128_t kPossibilities = analyzer->Possibilities();
+  Distribution distribution;
+  CardHands hands;
+  state.PrepareHands(hands);
+  analyzer->ExpectedDistribution(distribution, hands);
+  distribution.DistributeRemainingToPlayer(state.CurrentPlayersHand(), state.CurrentPlayer(), kPossibilities);
+  distribution.Validate(state.UnplayedCards(), kPossibilities);
+  distribution.AsProbabilities(record.prob);
+
+  for (unsigned i=0; i<choices.Size(); ++i) {
+    const float kEpsilon = 0.001;  // a little fudge factor for inexact floating point.
+    assert(expectedScore[i] >=  0.0 - kEpsilon);
+    assert(expectedScore[i] <= 26.0 + kEpsilon);
+    record.expectedScore[i] = expectedScore[i];
+    record.winsTrickProb[i] = winsTrickProb[i];
+    for (int j=0; j<3; j++) {
+      record.moonProb[i][j] = moonProb[i][j];
+    }
+  }
+
+  fwrite(&record, sizeof(record), 1, mFile);
+}
@@ -0,0 +1,26 @@
+// lib/WriteBinaryDataAnnotator.h
+#pragma once
+
+#include "lib/Annotator.h"
+#include <stdio.h>
+
+// Writes the same annotations as WriteDataAnnotator, but as fixed-width AnnotationRecords (see AnnotationRecord.h)
+// appended to a single file data/<hash>.rec. Use the `convert` tool to turn these files into training memmaps.
+
+class WriteBinaryDataAnnotator : public Annotator {
+public:
+  ~WriteBinaryDataAnnotator();
+  WriteBinaryDataAnnotator();
+
+  virtual void On_DnnMonteCarlo_choosePlay(const KnowableState& state, PossibilityAnalyzer* analyzer
+                                 , const float expectedScore[13], const float moonProb[13][3]);
+
+  virtual void OnGameStateBeforePlay(const GameState& state);
+
+  virtual void OnWriteData(const KnowableState& state, PossibilityAnalyzer* analyzer, const float expectedScore[13]
+  , const float moonProb[13][3], const float winsTrickProb[13]);
+
+private:
+  const std::string mHash;
+  FILE* mFile;
+};
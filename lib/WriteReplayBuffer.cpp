@@ -0,0 +1,34 @@
+// lib/WriteReplayBuffer.cpp
+
+#include "lib/WriteReplayBuffer.h"
+#include "lib/WriteTrainingDataSets.h"
+
+WriteReplayBuffer::~WriteReplayBuffer()
+{
+}
+
+WriteReplayBuffer::WriteReplayBuffer(const ReplayBufferPtr& buffer)
+: mBuffer(buffer)
+{
+}
+
+void WriteReplayBuffer::On_DnnMonteCarlo_choosePlay(const KnowableState& state
+                                  , PossibilityAnalyzer* analyzer
+                                  , const float expectedScore[13], const float moonProb[13][3])
+{
+}
+
+void WriteReplayBuffer::OnGameStateBeforePlay(const GameState& state)
+{
+}
+
+void WriteReplayBuffer::OnWriteData(const KnowableState& state, PossibilityAnalyzer* analyzer, const float expectedScore[13]
+                          , const float moonProb[13][3], const float winsTrickProb[13])
+{
+  FloatMatrix mainData = state.AsFloatMatrix();
+  FloatVector scoreData(kCardsPerDeck);
+  FloatVector trickData(kCardsPerDeck);
+  FloatMatrix moonData(kCardsPerDeck, 3);
+  MakeTrainingLabels(state.LegalPlays(), expectedScore, moonProb, winsTrickProb, scoreData, trickData, moonData);
+  mBuffer->Append(mainData, scoreData, trickData, moonData);
+}
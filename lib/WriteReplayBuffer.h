@@ -0,0 +1,29 @@
+// lib/WriteReplayBuffer.h
+#pragma once
+
+#include "lib/Annotator.h"
+#include "lib/ReplayBuffer.h"
+
+#include <memory>
+
+typedef std::shared_ptr<ReplayBuffer> ReplayBufferPtr;
+
+// Appends the same samples as WriteTrainingDataSets to a ReplayBuffer instead of to .npy files.
+// One ReplayBuffer may be shared by any number of annotators and threads.
+
+class WriteReplayBuffer : public Annotator {
+public:
+  ~WriteReplayBuffer();
+  WriteReplayBuffer(const ReplayBufferPtr& buffer);
+
+  virtual void On_DnnMonteCarlo_choosePlay(const KnowableState& state, PossibilityAnalyzer* analyzer
+                                 , const float expectedScore[13], const float moonProb[13][3]);
+
+  virtual void OnGameStateBeforePlay(const GameState& state);
+
+  virtual void OnWriteData(const KnowableState& state, PossibilityAnalyzer* analyzer, const float expectedScore[13]
+  , const float moonProb[13][3], const float winsTrickProb[13]);
+
+private:
+  const ReplayBufferPtr mBuffer;
+};
@@ -34,19 +34,11 @@ void WriteTrainingDataSets::OnGameStateBeforePlay(const GameState& state)
 {
 }
 
-void WriteTrainingDataSets::OnWriteData(const KnowableState& state, PossibilityAnalyzer* analyzer, const float expectedScore[13]
-                          , const float moonProb[13][3], const float winsTrickProb[13])
+void MakeTrainingLabels(const CardHand& choices, const float expectedScore[13], const float moonProb[13][3]
+  , const float winsTrickProb[13], FloatVector& scoreData, FloatVector& trickData, FloatMatrix& moonData)
 {
-  FloatMatrix mainData = state.AsFloatMatrix();
-  mMainDataWriter.Append(mainData);
-
-  const CardHand choices = state.LegalPlays();
-
-  FloatVector scoreData(kCardsPerDeck);
   scoreData.setZero();
-  FloatVector trickData(kCardsPerDeck);
   trickData.setZero();
-  FloatMatrix moonData(kCardsPerDeck, 3);
   moonData.setZero();
 
   CardHand::iterator it(choices);
@@ -61,8 +53,62 @@ void WriteTrainingDataSets::OnWriteData(const KnowableState& state, PossibilityA
     }
     ++i;
   }
+}
+
+void WriteTrainingDataSets::OnWriteData(const KnowableState& state, PossibilityAnalyzer* analyzer, const float expectedScore[13]
+                          , const float moonProb[13][3], const float winsTrickProb[13])
+{
+  FloatMatrix mainData = state.AsFloatMatrix();
+  mMainDataWriter.Append(mainData);
+
+  FloatVector scoreData(kCardsPerDeck);
+  FloatVector trickData(kCardsPerDeck);
+  FloatMatrix moonData(kCardsPerDeck, 3);
+  MakeTrainingLabels(state.LegalPlays(), expectedScore, moonProb, winsTrickProb, scoreData, trickData, moonData);
 
   mExpectedScoreWriter.Append(scoreData);
   mMoonProbWriter.Append(moonData);
   mWinTrickProbWriter.Append(trickData);
 }
+
+WriteTrainingDataSets::RolloutWriters::RolloutWriters(const std::string& prefix)
+: mMainDataWriter(prefix+"-main.npy", std::vector<int>({52, 10}))
+, mExpectedScoreWriter(prefix+"-score.npy", std::vector<int>({52}))
+, mMoonProbWriter(prefix+"-moon.npy", std::vector<int>({52, 3}))
+, mWinTrickProbWriter(prefix+"-trick.npy", std::vector<int>({52}))
+, mMaskWriter(prefix+"-mask.npy", std::vector<int>({52}))
+{
+}
+
+void WriteTrainingDataSets::OnRolloutSample(const KnowableState& state, Card play, float expectedScore
+                          , const float moonProb[3], float winsTrickProb)
+{
+  if (!mRolloutWriters)
+    mRolloutWriters.reset(new RolloutWriters(dataDirPath+mHash+"-rollout"));
+
+  assert(state.LegalPlays().HasCard(play));
+
+  FloatMatrix mainData = state.AsFloatMatrix();
+  mRolloutWriters->mMainDataWriter.Append(mainData);
+
+  FloatVector scoreData(kCardsPerDeck);
+  scoreData.setZero();
+  FloatVector trickData(kCardsPerDeck);
+  trickData.setZero();
+  FloatMatrix moonData(kCardsPerDeck, 3);
+  moonData.setZero();
+  FloatVector maskData(kCardsPerDeck);
+  maskData.setZero();
+
+  scoreData(play) = expectedScore;
+  trickData(play) = winsTrickProb;
+  for (int j=0; j<3; ++j) {
+    moonData(play, j) = moonProb[j];
+  }
+  maskData(play) = 1.0;
+
+  mRolloutWriters->mExpectedScoreWriter.Append(scoreData);
+  mRolloutWriters->mMoonProbWriter.Append(moonData);
+  mRolloutWriters->mWinTrickProbWriter.Append(trickData);
+  mRolloutWriters->mMaskWriter.Append(maskData);
+}
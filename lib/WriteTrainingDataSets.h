@@ -4,6 +4,15 @@
 #include "lib/Annotator.h"
 #include "lib/NumpyWriter.h"
 
+#include <memory>
+
+#include "lib/KnowableState.h"
+
+void MakeTrainingLabels(const CardHand& choices, const float expectedScore[13], const float moonProb[13][3]
+  , const float winsTrickProb[13], FloatVector& scoreData, FloatVector& trickData, FloatMatrix& moonData);
+  // Scatters the per-choice labels from OnWriteData into the per-card rows of the training data.
+  // Rows for cards that are not legal plays are zero.
+
 class WriteTrainingDataSets : public Annotator {
 public:
   ~WriteTrainingDataSets();
@@ -17,10 +26,29 @@ public:
   virtual void OnWriteData(const KnowableState& state, PossibilityAnalyzer* analyzer, const float expectedScore[13]
   , const float moonProb[13][3], const float winsTrickProb[13]);
 
+  virtual void OnRolloutSample(const KnowableState& state, Card play, float expectedScore, const float moonProb[3]
+  , float winsTrickProb);
+    // Rollout samples go to a separate set of files, data/<hash>-rollout-{main,score,moon,trick,mask}.npy.
+    // The main data is unchanged, so its eLegalPlay column still marks every legal play, but only the sampled
+    // play has labels. The extra `mask` array (one row of 52 per sample) marks that play, and must be used in
+    // place of the eLegalPlay column to mask the losses when training on these files.
+
 private:
+  struct RolloutWriters {
+    RolloutWriters(const std::string& prefix);
+    NumpyWriter<2> mMainDataWriter;
+    NumpyWriter<1> mExpectedScoreWriter;
+    NumpyWriter<2> mMoonProbWriter;
+    NumpyWriter<1> mWinTrickProbWriter;
+    NumpyWriter<1> mMaskWriter;
+  };
+
   const std::string mHash;
   NumpyWriter<2> mMainDataWriter;
   NumpyWriter<1> mExpectedScoreWriter;
   NumpyWriter<2> mMoonProbWriter;
   NumpyWriter<1> mWinTrickProbWriter;
+
+  std::unique_ptr<RolloutWriters> mRolloutWriters;
+    // Created on the first rollout sample, so that no empty files are left when sampling is off.
 };
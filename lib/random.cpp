@@ -9,29 +9,115 @@
 #include <strings.h>
 
 RandomGenerator::RandomGenerator()
+: mIndex(0)
+, mBufferEnd(0)
 {
-  const int kNumBytes = sizeof(mS);
+  uint64_t key[2];
+  const int kNumBytes = sizeof(key);
   int fd = open("/dev/urandom", O_RDONLY);
   assert(fd != -1);
-  int actual = read(fd, mS, kNumBytes);
+  int actual = read(fd, key, kNumBytes);
   close(fd);
   if (actual != kNumBytes) {
     fprintf(stderr, "Failed to read enough bytes to initialize RandomGenerator\n");
     exit(1);
   }
+  mSeed = key[0];
+  mStream = key[1];
+}
+
+RandomGenerator::RandomGenerator(uint64_t seed, uint64_t stream)
+: mSeed(seed)
+, mStream(stream)
+, mIndex(0)
+, mBufferEnd(0)
+{
+}
+
+// The Philox4x32 multipliers and Weyl sequence key increments, from the Random123 reference implementation.
+static const uint32_t kPhiloxM0 = 0xD2511F53;
+static const uint32_t kPhiloxM1 = 0xCD9E8D57;
+static const uint32_t kPhiloxW0 = 0x9E3779B9;
+static const uint32_t kPhiloxW1 = 0xBB67AE85;
+static const int kPhiloxRounds = 10;
+
+void RandomGenerator::PhiloxBlock(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4])
+{
+  uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < kPhiloxRounds; ++round) {
+    const uint64_t p0 = uint64_t(kPhiloxM0) * c0;
+    const uint64_t p1 = uint64_t(kPhiloxM1) * c2;
+    c0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+    c1 = uint32_t(p1);
+    c2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+    c3 = uint32_t(p0);
+    k0 += kPhiloxW0;
+    k1 += kPhiloxW1;
+  }
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+// Output 2b and 2b+1 of a stream are the two halves of block b, the Philox bijection of the counter
+// (b, stream) under the key seed. The blocks are computed lane by lane, so that the compiler can vectorize.
+void RandomGenerator::Generate(uint64_t seed, uint64_t stream, uint64_t firstBlock, uint64_t out[kBufferSize])
+{
+  const unsigned kLanes = kBufferSize / 2;
+  uint32_t c0[kLanes], c1[kLanes], c2[kLanes], c3[kLanes];
+  for (unsigned i = 0; i < kLanes; ++i) {
+    const uint64_t block = firstBlock + i;
+    c0[i] = uint32_t(block);
+    c1[i] = uint32_t(block >> 32);
+    c2[i] = uint32_t(stream);
+    c3[i] = uint32_t(stream >> 32);
+  }
+  uint32_t k0 = uint32_t(seed), k1 = uint32_t(seed >> 32);
+  for (int round = 0; round < kPhiloxRounds; ++round) {
+    for (unsigned i = 0; i < kLanes; ++i) {
+      const uint64_t p0 = uint64_t(kPhiloxM0) * c0[i];
+      const uint64_t p1 = uint64_t(kPhiloxM1) * c2[i];
+      c0[i] = uint32_t(p1 >> 32) ^ c1[i] ^ k0;
+      c1[i] = uint32_t(p1);
+      c2[i] = uint32_t(p0 >> 32) ^ c3[i] ^ k1;
+      c3[i] = uint32_t(p0);
+    }
+    k0 += kPhiloxW0;
+    k1 += kPhiloxW1;
+  }
+  for (unsigned i = 0; i < kLanes; ++i) {
+    out[2*i] = (uint64_t(c1[i]) << 32) | c0[i];
+    out[2*i + 1] = (uint64_t(c3[i]) << 32) | c2[i];
+  }
+}
+
+void RandomGenerator::Refill() const
+{
+  const uint64_t first = mIndex - mIndex % kBufferSize;
+  Generate(mSeed, mStream, first / 2, mBuffer);
+  mBufferEnd = first + kBufferSize;
+}
 
-  mP = 0;
+void RandomGenerator::Fill(uint64_t* out, size_t count) const
+{
+  // Take what is buffered, then whole buffers' worth directly, then the rest from a new buffer.
+  while (count > 0 && mIndex % kBufferSize != 0) {
+    *out++ = random64();
+    --count;
+  }
+  for (; count >= kBufferSize; count -= kBufferSize, out += kBufferSize, mIndex += kBufferSize)
+    Generate(mSeed, mStream, mIndex / 2, out);
+  while (count > 0) {
+    *out++ = random64();
+    --count;
+  }
 }
 
-uint64_t RandomGenerator::random64() const
+void RandomGenerator::Advance(uint64_t count)
 {
-  // see https://en.wikipedia.org/wiki/Xorshift
-  // This is the xorshift1024star generator, which has a period of 2^1024 − 1
-  const uint64_t s0 = mS[mP];
-  uint64_t s1 = mS[mP = (mP + 1) & 15];
-  s1 ^= s1 << 31; // a
-  mS[mP] = s1 ^ s0 ^ (s1 >> 11) ^ (s0 >> 30); // b,c
-  return mS[mP] * 1181783497276652981ul;
+  mIndex += count;
 }
 
 uint128_t RandomGenerator::random128() const
@@ -40,28 +126,40 @@ uint128_t RandomGenerator::random128() const
   return (result<<64) + random64();
 }
 
-uint64_t RandomGenerator::range64(uint64_t range) const
+// The 256 bit product a * b, as its high and low 128 bit halves.
+static inline void multiply128(uint128_t a, uint128_t b, uint128_t& high, uint128_t& low)
 {
-  const uint64_t MAX64 = ~uint64_t(0);
-  const uint64_t buckets = MAX64 / range;
-  const uint64_t limit = buckets * range;
-  uint64_t r = random64();
-  while (r >= limit)
-    r = random64();
-  return r / buckets;
+  const uint64_t a0 = uint64_t(a), a1 = uint64_t(a >> 64);
+  const uint64_t b0 = uint64_t(b), b1 = uint64_t(b >> 64);
+  const uint128_t p00 = uint128_t(a0) * b0;
+  const uint128_t p01 = uint128_t(a0) * b1;
+  const uint128_t p10 = uint128_t(a1) * b0;
+  const uint128_t p11 = uint128_t(a1) * b1;
+  const uint128_t middle = (p00 >> 64) + uint64_t(p01) + uint64_t(p10);
+  low = (middle << 64) | uint64_t(p00);
+  high = p11 + (p01 >> 64) + (p10 >> 64) + (middle >> 64);
 }
 
 uint128_t RandomGenerator::range128(uint128_t range) const
 {
-  const uint128_t buckets = MAX128 / range;
-  const uint128_t limit = buckets * range;
-  uint128_t r = random128();
-  while (r >= limit)
-    r = random128();
-  return r / buckets;
+  uint128_t high, low;
+  multiply128(random128(), range, high, low);
+  if (low < range) {
+    const uint128_t threshold = -range % range;
+    while (low < threshold)
+      multiply128(random128(), range, high, low);
+  }
+  return high;
 }
 
-dlib::thread_specific_data<RandomGenerator> RandomGenerator::gRandomGenerator;
+uint128_t RandomGenerator::range128(const BoundedRange128& range) const
+{
+  uint128_t high, low;
+  multiply128(random128(), range.range, high, low);
+  while (low < range.threshold)
+    multiply128(random128(), range.range, high, low);
+  return high;
+}
 
 const uint128_t zero = 0;
 const uint128_t RandomGenerator::MAX128 = ~zero;
@@ -1,40 +1,124 @@
 #pragma once
 
 #include "lib/math.h"
-#include "dlib/threads.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+// A counter-based generator: Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC11).
+// The n-th output of a generator is a pure function of (seed, stream, n), so generators are cheap to create, any
+// number of independent streams can be made from one seed (e.g. one per game, or per task), and a generator can
+// jump to any position in its stream.
+
+// A range [0, range) to sample many times, with the rejection threshold of RandomGenerator::range64 computed once,
+// so that sampling it never divides.
+struct BoundedRange64
+{
+  explicit BoundedRange64(uint64_t range) : range(range), threshold((assert(range > 0), -range % range)) {}
+
+  uint64_t range;
+  uint64_t threshold;
+    // 2^64 mod range
+};
+
+struct BoundedRange128
+{
+  explicit BoundedRange128(uint128_t range) : range(range), threshold((assert(range > 0), -range % range)) {}
+
+  uint128_t range;
+  uint128_t threshold;
+    // 2^128 mod range
+};
 
 class RandomGenerator
 {
 public:
   RandomGenerator();
+    // Seeded from /dev/urandom
 
-  uint64_t random64() const;
+  explicit RandomGenerator(uint64_t seed, uint64_t stream = 0);
+    // Deterministically seeded. Generators with different seeds, or different streams of one seed, produce
+    // unrelated sequences.
 
-  uint64_t range64(uint64_t range) const;
+  uint64_t random64() const
+  {
+    if (mIndex >= mBufferEnd)
+      Refill();
+    return mBuffer[mIndex++ % kBufferSize];
+  }
+
+  uint64_t range64(uint64_t range) const
+  {
+    // Lemire, "Fast Random Integer Generation in an Interval" (2019): the high word of random64() * range is
+    // uniform in [0, range) once the products whose low word is below 2^64 mod range are rejected. Only a low word
+    // below range can be rejected, so the modulus is rarely computed.
+    uint128_t m = uint128_t(random64()) * range;
+    if (uint64_t(m) < range) {
+      const uint64_t threshold = -range % range;
+      while (uint64_t(m) < threshold)
+        m = uint128_t(random64()) * range;
+    }
+    return uint64_t(m >> 64);
+  }
+
+  uint64_t range64(const BoundedRange64& range) const
+  {
+    uint128_t m = uint128_t(random64()) * range.range;
+    while (uint64_t(m) < range.threshold)
+      m = uint128_t(random64()) * range.range;
+    return uint64_t(m >> 64);
+  }
 
   uint128_t random128() const;
 
   uint128_t range128(uint128_t range) const;
+    // As range64, with the 256 bit product of random128() and range.
+
+  uint128_t range128(const BoundedRange128& range) const;
+
+  void Fill(uint64_t* out, size_t count) const;
+    // The next count outputs of random64(), computed in bulk.
+
+  void Advance(uint64_t count);
+    // Skips the next count outputs, in constant time.
+
+  uint64_t Position() const { return mIndex; }
+    // The number of outputs of random64() produced or skipped so far.
+
+  static void PhiloxBlock(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]);
+    // The Philox4x32-10 bijection of one counter under one key.
 
 public:
-  static const RandomGenerator& ThreadSpecific() { return gRandomGenerator.data(); }
+  static const RandomGenerator& ThreadSpecific()
+  {
+    thread_local const RandomGenerator generator;
+    return generator;
+  }
 
-  static uint64_t Random64() { return gRandomGenerator.data().random64(); }
+  static uint64_t Random64() { return ThreadSpecific().random64(); }
 
-  static uint64_t Range64(uint64_t range) { return gRandomGenerator.data().range64(range); }
+  static uint64_t Range64(uint64_t range) { return ThreadSpecific().range64(range); }
 
-  static uint128_t Random128() { return gRandomGenerator.data().random128(); }
+  static uint128_t Random128() { return ThreadSpecific().random128(); }
 
-  static uint128_t Range128(uint128_t range) { return gRandomGenerator.data().range128(range); }
+  static uint128_t Range128(uint128_t range) { return ThreadSpecific().range128(range); }
 
 public:
   static const uint128_t MAX128;
 
 private:
-  // The state must be seeded so that it is not everywhere zero.
-  mutable uint64_t mS[16];
-  mutable int mP;
+  static const unsigned kBufferSize = 16;
+    // Outputs are made kBufferSize at a time, i.e. eight Philox blocks of two outputs each, which the compiler
+    // can compute eight lanes wide.
 
-private:
-  static dlib::thread_specific_data<RandomGenerator> gRandomGenerator;
+  void Refill() const;
+  static void Generate(uint64_t seed, uint64_t stream, uint64_t firstBlock, uint64_t out[kBufferSize]);
+
+  uint64_t mSeed;
+  uint64_t mStream;
+  mutable uint64_t mIndex;
+    // The position in the stream of the next output.
+  mutable uint64_t mBufferEnd;
+    // mBuffer holds the outputs [mBufferEnd - kBufferSize, mBufferEnd), at their position modulo kBufferSize.
+  mutable uint64_t mBuffer[kBufferSize];
 };
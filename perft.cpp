@@ -0,0 +1,162 @@
+// perft.cpp
+// Counts the legal play sequences from a position to a fixed depth (see lib/Perft.h), reporting the count and
+// leaves per second at each depth. With --expect it is a check of the legality rules: it exits with status 1 if the
+// count at the final depth differs.
+
+#include "lib/Deal.h"
+#include "lib/GameState.h"
+#include "lib/Perft.h"
+#include "lib/RandomStrategy.h"
+
+#include "lib/math.h"
+#include "lib/random.h"
+#include "lib/timer.h"
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <thread>
+
+unsigned gDepth = 10;
+unsigned gPlayNumber = 0;
+uint64_t gSeed = 1;
+int gThreads = std::thread::hardware_concurrency();
+unsigned gSplitDepth = 2;
+bool gBulk = true;
+bool gDivide = false;
+bool gHaveExpected = false;
+uint64_t gExpected = 0;
+bool gHaveDealIndex = false;
+uint128_t gDealIndex = 0;
+
+void usage()
+{
+    const char* lines[] = {"Usage: perft [options...] [<hexDealIndex>]",
+        "  Options:", "    -d,--depth <int>           the number of plays to search (default:10)",
+        "    -p,--play <int>            the play number to start from, reached by random play (default:0)",
+        "    --seed <int>               the seed for the deal, when no deal index is given, and for the random",
+        "                               play to the starting play number (default:1)",
+        "    -t,--threads <int>         the number of threads, 1 to count serially (default:hardware threads)",
+        "    -s,--split <int>           the depth at which subtrees are split across threads (default:2)",
+        "    --no-bulk                  play every card of the last play, rather than counting legal plays",
+        "    --divide                   also print the count below each legal play from the starting position",
+        "    -e,--expect <count>        exit with status 1 unless the count at the full depth is count",
+        "    -h,--help                  print this message", 0};
+    for (int i = 0; lines[i] != 0; ++i)
+        printf("%s\n", lines[i]);
+    exit(0);
+}
+
+void parseArgs(int argc, char** argv)
+{
+    enum
+    {
+        kSeedOption = 'S' + 256,
+        kNoBulkOption,
+        kDivideOption,
+    };
+    const struct option longopts[] = {{"depth", required_argument, NULL, 'd'},
+        {"play", required_argument, NULL, 'p'}, {"seed", required_argument, NULL, kSeedOption},
+        {"threads", required_argument, NULL, 't'}, {"split", required_argument, NULL, 's'},
+        {"no-bulk", no_argument, NULL, kNoBulkOption}, {"divide", no_argument, NULL, kDivideOption},
+        {"expect", required_argument, NULL, 'e'}, {"help", no_argument, NULL, 'h'}, {NULL, 0, NULL, 0}};
+
+    while (true)
+    {
+        int longindex = 0;
+        int ch = getopt_long(argc, argv, "d:p:t:s:e:h", longopts, &longindex);
+        if (ch == -1)
+            break;
+
+        switch (ch)
+        {
+        case 'd':
+            gDepth = atoi(optarg);
+            break;
+        case 'p':
+            gPlayNumber = atoi(optarg);
+            break;
+        case kSeedOption:
+            gSeed = strtoull(optarg, 0, 10);
+            break;
+        case 't':
+            gThreads = atoi(optarg);
+            break;
+        case 's':
+            gSplitDepth = atoi(optarg);
+            break;
+        case kNoBulkOption:
+            gBulk = false;
+            break;
+        case kDivideOption:
+            gDivide = true;
+            break;
+        case 'e':
+            gHaveExpected = true;
+            gExpected = strtoull(optarg, 0, 10);
+            break;
+        case 'h':
+        default:
+            usage();
+            break;
+        }
+    }
+
+    if (optind < argc)
+    {
+        gHaveDealIndex = true;
+        gDealIndex = parseHex128(argv[optind++]);
+    }
+    if (optind < argc || gDepth == 0 || gPlayNumber >= 52 || gThreads <= 0)
+        usage();
+}
+
+int main(int argc, char** argv)
+{
+    parseArgs(argc, argv);
+
+    const RandomGenerator rng(gSeed);
+    const uint128_t dealIndex = gHaveDealIndex ? gDealIndex : Deal::RandomDealIndex(rng);
+    GameState state{Deal(dealIndex)};
+    const StrategyPtr random(new RandomStrategy());
+    while (state.PlayNumber() < gPlayNumber)
+        state.NextPlay(random, rng);
+
+    printf("Deal %s, play %u, %s, %d thread(s), split depth %u\n", asHexString(dealIndex).c_str(),
+        state.PlayNumber(), gBulk ? "bulk" : "no bulk", gThreads, gSplitDepth);
+
+    uint64_t leaves = 0;
+    double totalTime = 0.0;
+    uint64_t totalLeaves = 0;
+    for (unsigned depth = 1; depth <= gDepth; ++depth)
+    {
+        const double start = now();
+        leaves = ParallelPerft(state, depth, gSplitDepth, gThreads, gBulk);
+        const double elapsed = delta(start);
+        totalTime += elapsed;
+        totalLeaves += leaves;
+        printf("perft(%2u) = %16llu  %9.3fs  %12.0f leaves/s\n", depth, (unsigned long long) leaves, elapsed,
+            elapsed > 0.0 ? leaves / elapsed : 0.0);
+        fflush(stdout);
+    }
+    printf("Total %llu leaves in %.3fs, %.0f leaves/s\n", (unsigned long long) totalLeaves, totalTime,
+        totalTime > 0.0 ? totalLeaves / totalTime : 0.0);
+
+    if (gDivide)
+    {
+        uint64_t divided = 0;
+        for (const PerftDivision& division : PerftDivide(state, gDepth, gSplitDepth, gThreads, gBulk))
+        {
+            printf("%s %llu\n", NameOf(division.play), (unsigned long long) division.leaves);
+            divided += division.leaves;
+        }
+        assert(divided == leaves);
+    }
+
+    if (gHaveExpected && leaves != gExpected)
+    {
+        fprintf(stderr, "perft(%u) = %llu, expected %llu\n", gDepth, (unsigned long long) leaves,
+            (unsigned long long) gExpected);
+        return 1;
+    }
+    return 0;
+}
@@ -2,59 +2,240 @@
 
 #include "play_hearts/server/PlayerSession.h"
 
+#include "lib/KnowableState.h"
 #include "lib/random.h"
+#include "lib/timer.h"
 #include "play_hearts/conversions.h"
-#include "play_hearts/server/ClientPlayer.h"
 
 #include <algorithm>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 using playhearts::Hello;
+using playhearts::YourTurn;
 
-PlayerSession::PlayerSession(ServerReaderWriter<ServerMessage, ClientMessage>* stream, const char* modelpath)
-    : mStream(stream)
-    , mModelPath(modelpath)
+// The longest a client may ask the AI to take per move.
+const unsigned kMaxMoveMillis = 5000;
+
+// The number of the human's plays whose AI reply is pondered.
+const unsigned kMaxPonderedPlays = 4;
+
+// Gives the calling thread the lowest scheduling priority. Linux applies a nice value to just the one thread.
+static void lowerThreadPriority()
+{
+  thread_local bool lowered = false;
+  if (!lowered)
+  {
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+    lowered = true;
+  }
+}
+
+// Plays as another strategy does, but with a deadline for every move.
+class MoveBudgetStrategy : public Strategy
+{
+public:
+  MoveBudgetStrategy(const StrategyPtr& strategy, double seconds)
+      : mStrategy(strategy)
+      , mSeconds(seconds)
+  {}
+
+  virtual Card choosePlay(const KnowableState& state, const RandomGenerator& rng) const
+  {
+    return mStrategy->choosePlayBy(state, rng, now() + mSeconds);
+  }
+
+  virtual Card ponderPlay(const KnowableState& state, const RandomGenerator& rng, const std::atomic<bool>& cancelled) const
+  {
+    return mStrategy->ponderPlay(state, rng, cancelled);
+  }
+
+  virtual Card predictOutcomes(const KnowableState& state, const RandomGenerator& rng, float playExpectedValue[13]) const
+  {
+    return mStrategy->predictOutcomes(state, rng, playExpectedValue);
+  }
+
+private:
+  const StrategyPtr mStrategy;
+  const double mSeconds;
+};
+
+void PlayerSession::Listen(const SessionResources& resources, ServerCompletionQueue* cq)
+{
+  new PlayerSession(resources, cq);
+}
+
+void PlayerSession::Dispatch(void* tag, bool ok)
+{
+  Tag* t = static_cast<Tag*>(tag);
+  t->session->Proceed(t->event, ok);
+}
+
+PlayerSession::PlayerSession(const SessionResources& resources, ServerCompletionQueue* cq)
+    : mResources(resources)
+    , mCq(cq)
+    , mStream(&mContext)
+    , mConnectedTag{this, kConnected}
+    , mReadTag{this, kRead}
+    , mWrittenTag{this, kWritten}
+    , mFinishedTag{this, kFinished}
+    , mDoneTag{this, kDone}
+    , mReading(false)
+    , mWriting(false)
+    , mFinishPending(false)
+    , mFinishing(false)
+    , mDone(false)
+    , mJobs(0)
+    , mOpponent(resources.opponent)
+    , mReferenceReady(false)
+    , mHandOver(false)
+    , mAwaitingPlay(false)
+    , mHavePonderedReply(false)
 {
-  assert(mModelPath != nullptr);
   mTotals.fill(0);
   mReferenceTotals.fill(0);
+
+  // Must precede the request. The done tag is only delivered if the call starts.
+  mContext.AsyncNotifyWhenDone(&mDoneTag);
+  mResources.service->RequestConnect(&mContext, &mStream, mCq, mCq, &mConnectedTag);
 }
 
-Status PlayerSession::ManageSession()
+void PlayerSession::Proceed(Event event, bool ok)
 {
-  ClientMessage clientMessage;
-  while (mStream->Read(&clientMessage))
+  if (event == kConnected && !ok)
   {
-    if (clientMessage.req_case() != ClientMessage::kPlayer)
-      assert(clientMessage.sessiontoken() == mSessionToken);
+    // The server is shutting down and no call arrived. Nothing else refers to this session.
+    delete this;
+    return;
+  }
 
-    switch (clientMessage.req_case())
+  Locked([this, event, ok]() {
+    switch (event)
     {
-      case ClientMessage::kPlayer:
+      case kConnected:
+      {
+        // Be ready for the next client, then start reading this one's messages.
+        Listen(mResources, mCq);
+        mReading = true;
+        mStream.Read(&mIncoming, &mReadTag);
+        break;
+      }
+      case kRead:
       {
-        OnPlayer(clientMessage.player());
+        mReading = false;
+        if (!ok)
+        {
+          // The client closed the stream (or the call was cancelled). Any hand in progress is abandoned.
+          mFinishPending = true;
+          WriteNext();
+          break;
+        }
+        if (mDone)
+          break; // the session ended while this read was in flight
+        OnClientMessage(mIncoming);
+        if (!mFinishPending && !mDone)
+        {
+          mReading = true;
+          mStream.Read(&mIncoming, &mReadTag);
+        }
         break;
       }
-      case ClientMessage::kStartGame:
+      case kWritten:
       {
-        OnStartGame(clientMessage.startgame());
+        mWriting = false;
+        if (ok)
+          mOutgoing.pop_front();
+        else
+          mOutgoing.clear(); // the call is broken; the done event follows
+        WriteNext();
         break;
       }
-      case ClientMessage::kMyPlay:
+      case kFinished:
       {
-        assert(false); // this is now handed in ClientPlayer::choosePlay()
-        // OnMyPlay(clientMessage.myplay());
+        mFinishing = false;
         break;
       }
-      case ClientMessage::REQ_NOT_SET:
+      case kDone:
       {
-        assert(false);
+        mDone = true;
+        mAwaitingPlay = false;
+        StopPondering();
+        if (mContext.IsCancelled())
+          std::cout << "Session " << mSessionToken << " cancelled" << std::endl;
         break;
       }
     }
+  });
+}
+
+void PlayerSession::Locked(const std::function<void()>& update)
+{
+  std::vector<std::pair<dlib::thread_pool*, Job>> jobs;
+  bool canDelete;
+  {
+    dlib::auto_mutex lock(mMutex);
+    update();
+    jobs.swap(mPendingJobs);
+    canDelete = CanDelete();
+  }
+
+  // Submitted without holding the lock, since the pool may run a task in the submitting thread.
+  for (auto& job : jobs)
+    job.first->add_task_by_value(job.second);
+
+  if (canDelete)
+    delete this;
+}
+
+void PlayerSession::Queue(dlib::thread_pool* pool, const Job& job)
+{
+  ++mJobs;
+  mPendingJobs.push_back(std::make_pair(pool, job));
+}
+
+bool PlayerSession::CanDelete() const
+{
+  return mDone && !mReading && !mWriting && !mFinishing && mJobs == 0 && mPendingJobs.empty();
+}
+
+void PlayerSession::OnClientMessage(const ClientMessage& clientMessage)
+{
+  // Until the Player message is answered with a Hello the session token is empty, and so would match anything.
+  if (clientMessage.req_case() != ClientMessage::kPlayer && mSessionToken.empty())
+  {
+    Finish(Status(grpc::StatusCode::FAILED_PRECONDITION, "Expected a Player message first"));
+    return;
+  }
+  if (clientMessage.req_case() != ClientMessage::kPlayer && clientMessage.sessiontoken() != mSessionToken)
+  {
+    Finish(Status(grpc::StatusCode::PERMISSION_DENIED, "Bad session token"));
+    return;
   }
 
-  std::cout << "Server Connect ending." << std::endl;
-  return Status::OK;
+  switch (clientMessage.req_case())
+  {
+    case ClientMessage::kPlayer:
+    {
+      OnPlayer(clientMessage.player());
+      break;
+    }
+    case ClientMessage::kStartGame:
+    {
+      OnStartGame(clientMessage.startgame());
+      break;
+    }
+    case ClientMessage::kMyPlay:
+    {
+      OnMyPlay(clientMessage.myplay());
+      break;
+    }
+    case ClientMessage::REQ_NOT_SET:
+    {
+      Finish(Status(grpc::StatusCode::INVALID_ARGUMENT, "Empty client message"));
+      break;
+    }
+  }
 }
 
 void PlayerSession::OnPlayer(const Player& player)
@@ -70,27 +251,60 @@ void PlayerSession::OnPlayer(const Player& player)
   ServerMessage serverMessage;
   Hello* helloMessage = serverMessage.mutable_hello();
   helloMessage->set_sessiontoken(mSessionToken);
-  mStream->Write(serverMessage);
+  Send(serverMessage);
   std::cout << "Sent Hello " << mSessionToken << std::endl;
 }
 
 void PlayerSession::OnStartGame(const StartGame& startGame)
 {
   std::cout << "Received StartGame " << mPlayerName << " " << mSessionToken << std::endl;
+  if (mGame || mHandOver)
+  {
+    std::cout << "Ignoring StartGame during a hand" << std::endl;
+    return;
+  }
+
+  if (startGame.movemillis() > 0)
+  {
+    const double seconds = std::min(startGame.movemillis(), kMaxMoveMillis) / 1000.0;
+    mOpponent.reset(new MoveBudgetStrategy(mResources.opponent, seconds));
+  }
 
-  uint128_t N = Deal::RandomDealIndex();
-  GameState gameState(N);
+  // The reference game is the AI in all four seats. It is played on the compute pool (or found in the cache) while
+  // the human plays the same deal, and is only needed for the hand result.
+  const uint128_t N = Deal::RandomDealIndex();
+  const StrategyPtr opponent = mOpponent;
+  mReferenceReady = false;
+  Queue(mResources.computePool, [this, N, opponent]() {
+    StrategyPtr players[4] = {opponent, opponent, opponent, opponent};
+    const GameOutcome referenceOutcome =
+        mResources.referenceCache->PlayGame(N, players, RandomGenerator::ThreadSpecific());
+    Locked([this, &referenceOutcome]() {
+      --mJobs;
+      mReferenceOutcome = referenceOutcome;
+      mReferenceReady = true;
+      if (!mDone)
+        MaybeSendHandResult();
+    });
+  });
+
+  StartHand(N);
+}
+
+void PlayerSession::StartHand(uint128_t dealIndex)
+{
+  mGame.reset(new GameState(Deal(dealIndex)));
 
-  gameState.SetPlayCardHook([this, &gameState](int play, int player, Card card) {
+  mGame->SetPlayCardHook([this](int play, int player, Card card) {
     ServerMessage serverMessage;
     playhearts::CardPlayed* cardPlayed = serverMessage.mutable_cardplayed();
-    cardPlayed->set_playnumber(gameState.PlayNumber());
-    cardPlayed->set_player(gameState.CurrentPlayer());
+    cardPlayed->set_playnumber(play);
+    cardPlayed->set_player(player);
     setProtocolCard(cardPlayed->mutable_card(), card);
-    this->mStream->Write(serverMessage);
+    Send(serverMessage);
   });
 
-  gameState.SetTrickResultHook([this](int trickWinner, const std::array<unsigned, 4>& points) {
+  mGame->SetTrickResultHook([this](int trickWinner, const std::array<unsigned, 4>& points) {
     ServerMessage serverMessage;
     playhearts::TrickResult* trickResult = serverMessage.mutable_trickresult();
     trickResult->set_trickwinner(trickWinner);
@@ -98,29 +312,203 @@ void PlayerSession::OnStartGame(const StartGame& startGame)
     {
       trickResult->add_points(points[i]);
     }
-    this->mStream->Write(serverMessage);
+    Send(serverMessage);
   });
 
-  assert(mModelPath != nullptr);
-  StrategyPtr opponent = makePlayer(mModelPath);
-  StrategyPtr client(new ClientPlayer(mStream));
+  SendHand(mGame->HandForPlayer(0));
+  Advance();
+}
 
-  StrategyPtr players[4] = {opponent, opponent, opponent, opponent};
+void PlayerSession::Advance()
+{
+  while (!mGame->Done())
+  {
+    // As in GameState::NextPlay, forced plays are made without asking anyone.
+    const CardHand choices = mGame->LegalPlays();
+    if (mGame->PointsPlayed() == 26 || choices.Size() == 1)
+    {
+      mGame->PlayCard(choices.FirstCard());
+      continue;
+    }
+
+    if (mGame->CurrentPlayer() == 0)
+    {
+      mAwaitingPlay = true;
+      SendYourTurn();
+      StartPondering();
+      return;
+    }
+
+    if (mHavePonderedReply)
+    {
+      mHavePonderedReply = false;
+      assert(choices.HasCard(mPonderedReply));
+      mGame->PlayCard(mPonderedReply);
+      continue;
+    }
 
-  GameOutcome humanOutcome;
-  GameOutcome referenceOutcome;
+    const KnowableState knowableState(*mGame);
+    const StrategyPtr opponent = mOpponent;
+    Queue(mResources.computePool, [this, knowableState, opponent]() {
+      const Card card = opponent->choosePlay(knowableState, RandomGenerator::ThreadSpecific());
+      Locked([this, card]() {
+        --mJobs;
+        if (!mDone)
+          OnAIPlay(card);
+      });
+    });
+    return;
+  }
+
+  mHumanOutcome = mGame->CheckForShootTheMoon();
+  mGame.reset();
+  mHandOver = true;
+  MaybeSendHandResult();
+}
 
+void PlayerSession::MaybeSendHandResult()
+{
+  if (mHandOver && mReferenceReady)
   {
-    GameState reference(N);
-    referenceOutcome = reference.PlayGame(players, RandomGenerator::ThreadSpecific());
+    mHandOver = false;
+    SendHandResult(mHumanOutcome, mReferenceOutcome);
   }
+}
+
+void PlayerSession::OnAIPlay(Card card)
+{
+  assert(mGame->LegalPlays().HasCard(card));
+  mGame->PlayCard(card);
+  Advance();
+}
+
+void PlayerSession::OnMyPlay(const MyPlay& myPlay)
+{
+  if (!mAwaitingPlay)
   {
-    players[0] = client;
-    SendHand(gameState.HandForPlayer(0));
-    humanOutcome = gameState.PlayGame(players, RandomGenerator::ThreadSpecific());
+    std::cout << "Ignoring MyPlay when it is not the player's turn" << std::endl;
+    return;
   }
 
-  SendHandResult(humanOutcome, referenceOutcome);
+  const Card play = fromProtocolCard(myPlay.card());
+  if (!mGame->LegalPlays().HasCard(play))
+  {
+    std::cout << "Received illegal play " << NameOf(play) << std::endl;
+    SendYourTurn();
+    return;
+  }
+
+  mAwaitingPlay = false;
+  if (mPonder)
+  {
+    auto it = mPonder->replies.find(play);
+    if (it != mPonder->replies.end())
+    {
+      mHavePonderedReply = true;
+      mPonderedReply = it->second;
+    }
+    StopPondering();
+  }
+  mGame->PlayCard(play);
+  Advance();
+}
+
+void PlayerSession::StartPondering()
+{
+  assert(!mPonder);
+  mPonder = std::make_shared<Ponder>();
+
+  // The copy must not send messages as it is played.
+  GameState game(*mGame);
+  game.SetPlayCardHook(nullptr);
+  game.SetTrickResultHook(nullptr);
+
+  const std::shared_ptr<Ponder> ponder = mPonder;
+  const StrategyPtr opponent = mOpponent;
+  Queue(mResources.ponderPool, [this, ponder, game, opponent]() {
+    lowerThreadPriority();
+    PonderReplies(ponder, game, opponent);
+    Locked([this]() { --mJobs; });
+  });
+}
+
+void PlayerSession::StopPondering()
+{
+  if (mPonder)
+  {
+    mPonder->cancelled = true;
+    mPonder.reset();
+  }
+}
+
+void PlayerSession::PonderReplies(
+    const std::shared_ptr<Ponder>& ponder, const GameState& game, const StrategyPtr& opponent)
+{
+  const RandomGenerator& rng = RandomGenerator::ThreadSpecific();
+  const CardHand choices = game.LegalPlays();
+
+  // Rank the human's plays by how good the AI thinks they are, i.e. by how likely a good player is to make them.
+  float expectedValue[13];
+  opponent->predictOutcomes(KnowableState(game), rng, expectedValue);
+  std::vector<std::pair<float, Card>> ranked;
+  CardHand::iterator it(choices);
+  for (unsigned i = 0; i < choices.Size(); ++i)
+    ranked.push_back(std::make_pair(expectedValue[i], it.next()));
+  std::stable_sort(ranked.begin(), ranked.end(),
+      [](const std::pair<float, Card>& a, const std::pair<float, Card>& b) { return a.first < b.first; });
+  if (ranked.size() > kMaxPonderedPlays)
+    ranked.resize(kMaxPonderedPlays);
+
+  for (const auto& candidate : ranked)
+  {
+    if (ponder->cancelled)
+      return;
+
+    // Make the play, and any forced plays that follow, as Advance would.
+    GameState next(game);
+    next.PlayCard(candidate.second);
+    while (!next.Done() && (next.PointsPlayed() == 26 || next.LegalPlays().Size() == 1))
+      next.PlayCard(next.LegalPlays().FirstCard());
+    if (next.Done() || next.CurrentPlayer() == 0)
+      continue;
+
+    const Card reply = opponent->ponderPlay(KnowableState(next), rng, ponder->cancelled);
+    if (ponder->cancelled)
+      return; // the search may have stopped early, so its reply is not as good as a move's
+
+    Locked([&ponder, &candidate, reply]() { ponder->replies[candidate.second] = reply; });
+  }
+}
+
+void PlayerSession::Send(const ServerMessage& serverMessage)
+{
+  mOutgoing.push_back(serverMessage);
+  WriteNext();
+}
+
+void PlayerSession::WriteNext()
+{
+  if (mWriting || mFinishing || mDone)
+    return;
+  if (!mOutgoing.empty())
+  {
+    mWriting = true;
+    mStream.Write(mOutgoing.front(), &mWrittenTag);
+  }
+  else if (mFinishPending)
+  {
+    mFinishPending = false;
+    mFinishing = true;
+    mStream.Finish(mFinishStatus, &mFinishedTag);
+  }
+}
+
+void PlayerSession::Finish(const Status& status)
+{
+  // Sent once every queued message has been written.
+  mFinishStatus = status;
+  mFinishPending = true;
+  WriteNext();
 }
 
 bool PlayerSession::IsGameOver()
@@ -169,7 +557,7 @@ void PlayerSession::SendHandResult(const GameOutcome& humanOutcome, const GameOu
     mReferenceTotals[p] += score;
     result->add_referencetotals(mReferenceTotals[p]);
   }
-  mStream->Write(serverMessage);
+  Send(serverMessage);
 
   if (IsGameOver())
   {
@@ -191,7 +579,7 @@ void PlayerSession::SendGameResult()
     result->add_totals(mTotals[p]);
     result->add_referencetotals(mReferenceTotals[p]);
   }
-  mStream->Write(serverMessage);
+  Send(serverMessage);
   mTotals.fill(0);
   mReferenceTotals.fill(0);
 }
@@ -207,5 +595,40 @@ void PlayerSession::SendHand(const CardHand& hand)
     playhearts::Card* protoCard = protoCards->add_card();
     setProtocolCard(protoCard, it.next());
   }
-  mStream->Write(serverMessage);
+  Send(serverMessage);
+}
+
+void PlayerSession::SendYourTurn()
+{
+  const KnowableState knowableState(*mGame);
+
+  ServerMessage serverMessage;
+  YourTurn* yourTurn = serverMessage.mutable_yourturn();
+
+  yourTurn->set_playnumber(knowableState.PlayNumber());
+
+  int trickSuit = knowableState.TrickSuit();
+  if (trickSuit != kUnknown)
+    yourTurn->set_tricksuit(::playhearts::Suit(trickSuit));
+
+  ::playhearts::Cards* cards = yourTurn->mutable_tricksofar();
+  for (unsigned i = 0; i < knowableState.PlayInTrick(); ++i)
+    setProtocolCard(cards->add_card(), knowableState.GetTrickPlay(i));
+
+  {
+    CardHand choices = knowableState.LegalPlays();
+    ::playhearts::Cards* legalPlays = yourTurn->mutable_legalplays();
+    CardArray::iterator it(choices);
+    while (!it.done())
+      setProtocolCard(legalPlays->add_card(), it.next());
+  }
+
+  {
+    CardArray::iterator it(knowableState.CurrentPlayersHand());
+    ::playhearts::Cards* hand = yourTurn->mutable_hand();
+    while (!it.done())
+      setProtocolCard(hand->add_card(), it.next());
+  }
+
+  Send(serverMessage);
 }
@@ -10,13 +10,21 @@
 #include <grpc/grpc.h>
 
 #include "lib/GameState.h"
+#include "lib/OutcomeCache.h"
 
-using grpc::Server;
-using grpc::ServerBuilder;
+#include <dlib/threads.h>
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+using grpc::ServerAsyncReaderWriter;
+using grpc::ServerCompletionQueue;
 using grpc::ServerContext;
-using grpc::ServerReader;
-using grpc::ServerReaderWriter;
-using grpc::ServerWriter;
 using grpc::Status;
 
 using playhearts::ClientMessage;
@@ -25,30 +33,151 @@ using playhearts::Player;
 using playhearts::ServerMessage;
 using playhearts::StartGame;
 
+// What every session shares: the AI strategy, the pools its moves are computed on, and the reference game cache.
+struct SessionResources
+{
+  playhearts::PlayHearts::AsyncService* service;
+  StrategyPtr opponent;
+  dlib::thread_pool* computePool;
+  dlib::thread_pool* ponderPool;
+  // A few threads for pondering. They lower their scheduling priority, so pondering only uses otherwise idle CPU.
+  OutcomeCache* referenceCache;
+};
+
+// One client's Connect stream, served on the async completion queue API.
+//
+// A session never blocks a thread. It is a state machine advanced by completion queue events (the call arriving,
+// a client message read, a server message written, the call ending) and by AI moves completing on the compute pool.
+// A hand is played by stepping the GameState directly: AI seats submit a move to the compute pool, and the human's
+// seat sends YourTurn and waits for the MyPlay message, so between moves an idle session costs only its memory.
+//
+// While waiting for the human's play, the session ponders: on the ponder pool it searches the AI's reply to each of
+// the human's most plausible plays (as ranked by the AI's own predictOutcomes), most plausible first. If the human
+// makes a play whose reply is ready, the reply is made at once. Any other pondering is cancelled.
+//
+// Each session keeps one read outstanding at all times, and queues server messages so that one write is
+// outstanding at a time, as the API requires. All state is guarded by mMutex, since events arrive on the
+// completion queue threads and on compute pool threads. A session deletes itself once the call is done and it has
+// no operation or AI move outstanding.
+
 class PlayerSession
 {
 public:
-  PlayerSession(ServerReaderWriter<ServerMessage, ClientMessage>* stream, const char* modelpath);
+  static void Listen(const SessionResources& resources, ServerCompletionQueue* cq);
+  // Creates a session that waits for the next Connect call on cq.
+
+  static void Dispatch(void* tag, bool ok);
+  // Handles one event taken from a completion queue.
+
+private:
+  enum Event
+  {
+    kConnected,
+    kRead,
+    kWritten,
+    kFinished,
+    kDone,
+  };
+
+  struct Tag
+  {
+    PlayerSession* session;
+    Event event;
+  };
+
+  typedef std::function<void()> Job;
+  // Work to submit to a pool once mMutex is released.
+
+  struct Ponder
+  {
+    std::atomic<bool> cancelled{false};
+    std::map<Card, Card> replies;
+    // The AI's reply to each human play searched so far. Guarded by mMutex.
+  };
+
+  PlayerSession(const SessionResources& resources, ServerCompletionQueue* cq);
+  PlayerSession(const PlayerSession&); // unimplemented
 
-  Status ManageSession();
+  void Proceed(Event event, bool ok);
+  void Locked(const std::function<void()>& update);
+  // Runs update holding mMutex, then submits the jobs it queued, and deletes the session if it is finished.
+  void Queue(dlib::thread_pool* pool, const Job& job);
+  bool CanDelete() const;
 
+  void OnClientMessage(const ClientMessage& clientMessage);
   void OnPlayer(const Player& player);
   void OnStartGame(const StartGame& startGame);
-  void OnMyPlay(const MyPlay& myplay);
+  void OnMyPlay(const MyPlay& myPlay);
+
+  void StartHand(uint128_t dealIndex);
+  void Advance();
+  // Plays forced moves, then either sends YourTurn or queues the next AI move, or ends the hand.
+  void MaybeSendHandResult();
+  // Sends the hand result once both the human's hand and the reference game are over.
+  void OnAIPlay(Card card);
+  void StartPondering();
+  void StopPondering();
+  void PonderReplies(const std::shared_ptr<Ponder>& ponder, const GameState& game, const StrategyPtr& opponent);
+  // The ponder job: searches replies until cancelled or kMaxPonderedPlays are done.
+
+  void Send(const ServerMessage& serverMessage);
+  void WriteNext();
+  void Finish(const Status& status);
 
   void SendHand(const CardHand& hand);
+  void SendYourTurn();
   void SendHandResult(const GameOutcome& humanOutcome, const GameOutcome& referenceOutcome);
   void SendGameResult();
 
-private:
   bool IsGameOver();
 
-  ServerReaderWriter<ServerMessage, ClientMessage>* mStream;
-  const char* const mModelPath;
+  const SessionResources mResources;
+  ServerCompletionQueue* const mCq;
+
+  ServerContext mContext;
+  ServerAsyncReaderWriter<ServerMessage, ClientMessage> mStream;
+  Tag mConnectedTag, mReadTag, mWrittenTag, mFinishedTag, mDoneTag;
+
+  dlib::mutex mMutex;
+
+  ClientMessage mIncoming;
+  std::deque<ServerMessage> mOutgoing;
+  // The front message is being written while mWriting.
+
+  bool mReading;
+  bool mWriting;
+  bool mFinishPending;
+  bool mFinishing;
+  bool mDone;
+  int mJobs;
+  // The number of pool jobs referring to this session.
+
+  std::vector<std::pair<dlib::thread_pool*, Job>> mPendingJobs;
+  Status mFinishStatus;
+
   std::string mPlayerName;
   std::string mPlayerEmail;
   std::string mSessionToken;
 
+  StrategyPtr mOpponent;
+  // The AI players of this session's hands and reference games. A client may give them a time budget per move with
+  // StartGame's moveMillis, which overrides any budget of the shared opponent.
+
+  std::unique_ptr<GameState> mGame;
+  GameOutcome mReferenceOutcome;
+  bool mReferenceReady;
+  GameOutcome mHumanOutcome;
+  bool mHandOver;
+  // The human's hand is over, but its result waits for the reference game.
+  bool mAwaitingPlay;
+  // True from sending YourTurn until the human's MyPlay.
+
+  std::shared_ptr<Ponder> mPonder;
+  // While mAwaitingPlay, the replies being pondered.
+  bool mHavePonderedReply;
+  Card mPonderedReply;
+  // The AI's next decision, taken from the ponder when the human played.
+
   std::array<int, 4> mTotals;
   std::array<int, 4> mReferenceTotals;
 };
@@ -22,9 +22,13 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "play_hearts/server/PlayerSession.h"
 
+#include "lib/Strategy.h"
+
 #include "play_hearts.grpc.pb.h"
 #include <grpc++/security/server_credentials.h>
 #include <grpc++/server.h>
@@ -34,56 +38,65 @@
 
 using grpc::Server;
 using grpc::ServerBuilder;
-using grpc::ServerContext;
-using grpc::ServerReader;
-using grpc::ServerReaderWriter;
-using grpc::ServerWriter;
-using grpc::Status;
 
 using playhearts::PlayHearts;
 
-class PlayHeartsImpl final : public PlayHearts::Service
-{
-public:
-  explicit PlayHeartsImpl(const char* modelpath)
-      : mModelPath(modelpath)
-  {
-    assert(mModelPath != nullptr);
-  }
+// The number of completion queues, each drained by one thread. Sessions do no blocking work on these threads, so
+// a few suffice for any number of connected clients.
+const int kNumCompletionQueues = 2;
 
-  Status Connect(ServerContext*, ServerReaderWriter<ServerMessage, ClientMessage>* stream) override
+void PollCompletionQueue(const SessionResources& resources, ServerCompletionQueue* cq)
+{
+  PlayerSession::Listen(resources, cq);
+  void* tag;
+  bool ok;
+  while (cq->Next(&tag, &ok))
   {
-    assert(mModelPath != nullptr);
-    PlayerSession session(stream, mModelPath);
-    return session.ManageSession();
+    PlayerSession::Dispatch(tag, ok);
   }
+}
 
-private:
-  const char* mModelPath;
-};
-
-void RunServer(const char* modelpath)
+void RunServer(const char* modelpath, const char* cachepath)
 {
   assert(modelpath != nullptr);
 
   std::string server_address("0.0.0.0:50057");
-  PlayHeartsImpl service(modelpath);
+  PlayHearts::AsyncService service;
+
+  // The AI strategy is loaded once and shared, since choosePlay is safe to call concurrently.
+  OutcomeCache referenceCache(cachepath);
+  const unsigned numCores = std::max(1u, std::thread::hardware_concurrency());
+  dlib::thread_pool computePool(numCores);
+  dlib::thread_pool ponderPool(std::max(1u, numCores / 4));
+  const SessionResources resources = {&service, makePlayer(modelpath), &computePool, &ponderPool, &referenceCache};
 
   ServerBuilder builder;
   builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
   builder.RegisterService(&service);
+  std::vector<std::unique_ptr<ServerCompletionQueue>> queues;
+  for (int i = 0; i < kNumCompletionQueues; ++i)
+    queues.push_back(builder.AddCompletionQueue());
   std::unique_ptr<Server> server(builder.BuildAndStart());
   std::cout << "Server listening on " << server_address << std::endl;
-  server->Wait();
+
+  std::vector<std::thread> pollers;
+  for (auto& cq : queues)
+    pollers.emplace_back(PollCompletionQueue, resources, cq.get());
+  for (std::thread& poller : pollers)
+    poller.join();
 }
 
 int main(int argc, char** argv)
 {
-  assert(argc == 2);
+  // Without a cache path, reference game outcomes are only cached in memory.
+  if (argc != 2 && argc != 3)
+  {
+    std::cerr << "Usage: " << argv[0] << " <modelpath> [<outcomeCachePath>]" << std::endl;
+    return 1;
+  }
 
   const char* modelpath = argv[1];
-  assert(modelpath != nullptr);
-  RunServer(modelpath);
+  RunServer(modelpath, argc == 3 ? argv[2] : nullptr);
 
   return 0;
 }
@@ -0,0 +1,545 @@
+// play_hearts/testclient/load_client.cpp
+// A load generator for the play_hearts server: many bot players, each on its own Connect stream, all driven
+// asynchronously from a few completion queue threads. It reports the latency of each kind of server response and
+// the session and hand throughput, e.g. to size a server or catch a latency regression.
+
+#include "play_hearts.grpc.pb.h"
+#include "play_hearts/conversions.h"
+
+#include "lib/random.h"
+#include "lib/timer.h"
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grpc++/alarm.h>
+#include <grpc++/channel.h>
+#include <grpc++/client_context.h>
+#include <grpc++/create_channel.h>
+#include <grpc++/security/credentials.h>
+#include <grpc/grpc.h>
+
+using grpc::Channel;
+using grpc::ClientAsyncReaderWriter;
+using grpc::ClientContext;
+using grpc::CompletionQueue;
+using grpc::Status;
+
+using ::playhearts::ClientMessage;
+using ::playhearts::PlayHearts;
+using ::playhearts::ServerMessage;
+
+std::string gServer = "localhost:50057";
+int gNumSessions = 100;
+int gHandsPerSession = 10;
+int gNumThreads = 2;
+double gThinkMillis = 0.0;
+std::string gThinkDist = "exponential";
+uint64_t gSeed = 1;
+
+void usage()
+{
+  const char* lines[] = {"Usage: loadclient [options...]",
+      "  Plays many concurrent sessions against a play_hearts server, choosing random legal cards.", "  Options:",
+      "    -n,--sessions <int>       the number of concurrent sessions (default: 100)",
+      "    -g,--hands <int>          the hands each session plays before disconnecting (default: 10)",
+      "    -t,--think <ms>           the mean think time before each play (default: 0)",
+      "    --think-dist <dist>       fixed, uniform (0 to twice the mean) or exponential (default: exponential)",
+      "    -j,--threads <int>        the number of completion queue threads (default: 2)",
+      "    -a,--address <host:port>  the server (default: localhost:50057)",
+      "    -s,--seed <int>           the seed for plays and think times (default: 1)",
+      "    -h,--help                 print this message", 0};
+  for (int i = 0; lines[i] != 0; ++i)
+    printf("%s\n", lines[i]);
+  exit(0);
+}
+
+void parseArgs(int argc, char** argv)
+{
+  const struct option longopts[] = {{"sessions", required_argument, NULL, 'n'}, {"hands", required_argument, NULL, 'g'},
+      {"think", required_argument, NULL, 't'}, {"think-dist", required_argument, NULL, 'D'},
+      {"threads", required_argument, NULL, 'j'}, {"address", required_argument, NULL, 'a'},
+      {"seed", required_argument, NULL, 's'}, {"help", no_argument, NULL, 'h'}, {NULL, 0, NULL, 0}};
+
+  while (true)
+  {
+    int longindex = 0;
+    int ch = getopt_long(argc, argv, "n:g:t:j:a:s:h", longopts, &longindex);
+    if (ch == -1)
+    {
+      break;
+    }
+
+    switch (ch)
+    {
+      case 'n':
+      {
+        gNumSessions = atoi(optarg);
+        break;
+      }
+      case 'g':
+      {
+        gHandsPerSession = atoi(optarg);
+        break;
+      }
+      case 't':
+      {
+        gThinkMillis = atof(optarg);
+        break;
+      }
+      case 'D':
+      {
+        gThinkDist = optarg;
+        break;
+      }
+      case 'j':
+      {
+        gNumThreads = atoi(optarg);
+        break;
+      }
+      case 'a':
+      {
+        gServer = optarg;
+        break;
+      }
+      case 's':
+      {
+        gSeed = strtoull(optarg, 0, 10);
+        break;
+      }
+      case 'h':
+      default:
+      {
+        usage();
+        break;
+      }
+    }
+  }
+
+  if (gNumSessions <= 0 || gHandsPerSession <= 0 || gNumThreads <= 0 || gThinkMillis < 0.0
+      || (gThinkDist != "fixed" && gThinkDist != "uniform" && gThinkDist != "exponential"))
+  {
+    usage();
+  }
+}
+
+// The server responses whose latency is measured, each from the client message that prompts it.
+enum Response
+{
+  kHello,      // after Player
+  kHand,       // after StartGame
+  kYourTurn,   // after MyPlay, i.e. the AI's moves until the bot's next turn
+  kHandResult, // after the last MyPlay of the hand, including any wait for the reference game
+  kNumResponses,
+};
+
+const char* kResponseNames[kNumResponses] = {"Hello", "Hand", "YourTurn", "HandResult"};
+
+// The results of the sessions on one completion queue thread. Merged when the run is over.
+struct LoadStats
+{
+  std::vector<float> latencyMillis[kNumResponses];
+  unsigned sessionsCompleted = 0;
+  unsigned sessionsFailed = 0;
+  unsigned handsPlayed = 0;
+
+  void operator+=(const LoadStats& other)
+  {
+    for (int r = 0; r < kNumResponses; ++r)
+      latencyMillis[r].insert(latencyMillis[r].end(), other.latencyMillis[r].begin(), other.latencyMillis[r].end());
+    sessionsCompleted += other.sessionsCompleted;
+    sessionsFailed += other.sessionsFailed;
+    handsPlayed += other.handsPlayed;
+  }
+};
+
+std::mutex gRemainingMutex;
+std::condition_variable gRemainingChanged;
+int gRemaining = 0;
+
+// One bot's Connect stream. It plays a random legal card after a think time, for gHandsPerSession hands, then closes
+// the stream. All its events arrive on one completion queue, so it needs no locking.
+class BotSession
+{
+public:
+  static void Dispatch(void* tag, bool ok)
+  {
+    Tag* t = static_cast<Tag*>(tag);
+    t->session->Proceed(t->event, ok);
+  }
+
+  BotSession(PlayHearts::Stub* stub, CompletionQueue* cq, LoadStats* stats, uint64_t seed)
+      : mCq(cq)
+      , mStats(stats)
+      , mRng(seed)
+      , mStartedTag{this, kStarted}
+      , mReadTag{this, kRead}
+      , mWrittenTag{this, kWritten}
+      , mThoughtTag{this, kThought}
+      , mClosedTag{this, kClosed}
+      , mFinishedTag{this, kFinished}
+      , mPending(1)
+      , mWriting(false)
+      , mWritesDonePending(false)
+      , mFinishing(false)
+      , mLastSentAt(0.0)
+      , mLastSent(ClientMessage::REQ_NOT_SET)
+      , mHands(0)
+  {
+    mStream = stub->AsyncConnect(&mContext, mCq, &mStartedTag);
+  }
+
+private:
+  enum Event
+  {
+    kStarted,
+    kRead,
+    kWritten,
+    kThought,
+    kClosed,
+    kFinished,
+  };
+
+  struct Tag
+  {
+    BotSession* session;
+    Event event;
+  };
+
+  void Proceed(Event event, bool ok)
+  {
+    --mPending;
+    switch (event)
+    {
+      case kStarted:
+      {
+        if (!ok)
+        {
+          Finish();
+          break;
+        }
+        ClientMessage clientMessage;
+        playhearts::Player* player = clientMessage.mutable_player();
+        player->set_name("loadclient");
+        player->set_email("loadclient@localhost");
+        Send(clientMessage);
+        Read();
+        break;
+      }
+      case kRead:
+      {
+        if (!ok)
+        {
+          // The server ended the call, normally in response to WritesDone.
+          Finish();
+          break;
+        }
+        OnServerMessage();
+        Read();
+        break;
+      }
+      case kWritten:
+      {
+        mWriting = false;
+        mOutgoing.erase(mOutgoing.begin());
+        if (!ok)
+          mOutgoing.clear(); // the stream is broken; the pending read fails too
+        WriteNext();
+        break;
+      }
+      case kThought:
+      {
+        // The alarm is cancelled (ok is false) when the stream fails while the bot is thinking.
+        if (ok && !mFinishing)
+          Play();
+        break;
+      }
+      case kClosed:
+      {
+        mWriting = false;
+        break;
+      }
+      case kFinished:
+      {
+        const bool completed = mStatus.ok() && mHands == gHandsPerSession;
+        if (completed)
+          ++mStats->sessionsCompleted;
+        else
+          ++mStats->sessionsFailed;
+        if (!mStatus.ok())
+          fprintf(stderr, "Session failed: %s\n", mStatus.error_message().c_str());
+        break;
+      }
+    }
+
+    if (mPending == 0)
+    {
+      delete this;
+      std::lock_guard<std::mutex> lock(gRemainingMutex);
+      if (--gRemaining == 0)
+        gRemainingChanged.notify_all();
+    }
+  }
+
+  void OnServerMessage()
+  {
+    const double latencyMillis = (now() - mLastSentAt) * 1000.0;
+    switch (mIncoming.res_case())
+    {
+      case ServerMessage::kHello:
+      {
+        mStats->latencyMillis[kHello].push_back(latencyMillis);
+        mSessionToken = mIncoming.hello().sessiontoken();
+        StartGame();
+        break;
+      }
+      case ServerMessage::kHand:
+      {
+        mStats->latencyMillis[kHand].push_back(latencyMillis);
+        break;
+      }
+      case ServerMessage::kYourTurn:
+      {
+        if (mLastSent == ClientMessage::kMyPlay)
+          mStats->latencyMillis[kYourTurn].push_back(latencyMillis);
+        mLegalPlays = fromProtoCards(mIncoming.yourturn().legalplays());
+        Think();
+        break;
+      }
+      case ServerMessage::kHandResult:
+      {
+        mStats->latencyMillis[kHandResult].push_back(latencyMillis);
+        ++mStats->handsPlayed;
+        if (++mHands < gHandsPerSession)
+        {
+          StartGame();
+        }
+        else
+        {
+          mWritesDonePending = true;
+          WriteNext();
+        }
+        break;
+      }
+      default:
+      {
+        break;
+      }
+    }
+  }
+
+  void StartGame()
+  {
+    ClientMessage clientMessage;
+    clientMessage.set_sessiontoken(mSessionToken);
+    clientMessage.mutable_startgame();
+    Send(clientMessage);
+  }
+
+  void Think()
+  {
+    double millis = gThinkMillis;
+    if (gThinkDist == "uniform")
+      millis = 2.0 * gThinkMillis * mRng.random64() / 18446744073709551616.0;
+    else if (gThinkDist == "exponential")
+      millis = -gThinkMillis * log(1.0 - mRng.random64() / 18446744073709551616.0);
+
+    if (millis <= 0.0)
+    {
+      Play();
+      return;
+    }
+    ++mPending;
+    const auto deadline = std::chrono::system_clock::now() + std::chrono::microseconds(int64_t(millis * 1000.0));
+    mAlarm.Set(mCq, deadline, &mThoughtTag);
+  }
+
+  void Play()
+  {
+    const Card card = mLegalPlays.NthCard(mRng.range64(mLegalPlays.Size()));
+    ClientMessage clientMessage;
+    clientMessage.set_sessiontoken(mSessionToken);
+    setProtocolCard(clientMessage.mutable_myplay()->mutable_card(), card);
+    Send(clientMessage);
+  }
+
+  void Read()
+  {
+    ++mPending;
+    mStream->Read(&mIncoming, &mReadTag);
+  }
+
+  void Send(const ClientMessage& clientMessage)
+  {
+    mLastSentAt = now();
+    mLastSent = clientMessage.req_case();
+    mOutgoing.push_back(clientMessage);
+    WriteNext();
+  }
+
+  void WriteNext()
+  {
+    if (mWriting || mFinishing)
+      return;
+    if (!mOutgoing.empty())
+    {
+      mWriting = true;
+      ++mPending;
+      mStream->Write(mOutgoing.front(), &mWrittenTag);
+    }
+    else if (mWritesDonePending)
+    {
+      mWritesDonePending = false;
+      mWriting = true;
+      ++mPending;
+      mStream->WritesDone(&mClosedTag);
+    }
+  }
+
+  void Finish()
+  {
+    // No writes may be started once Finish has been requested.
+    mFinishing = true;
+    mAlarm.Cancel();
+    ++mPending;
+    mStream->Finish(&mStatus, &mFinishedTag);
+  }
+
+  CompletionQueue* const mCq;
+  LoadStats* const mStats;
+  const RandomGenerator mRng;
+
+  ClientContext mContext;
+  std::unique_ptr<ClientAsyncReaderWriter<ClientMessage, ServerMessage>> mStream;
+  grpc::Alarm mAlarm;
+  Status mStatus;
+  Tag mStartedTag, mReadTag, mWrittenTag, mThoughtTag, mClosedTag, mFinishedTag;
+
+  int mPending;
+  // The number of operations whose tag has not yet been delivered.
+
+  ServerMessage mIncoming;
+  std::vector<ClientMessage> mOutgoing;
+  bool mWriting;
+  bool mWritesDonePending;
+  bool mFinishing;
+
+  double mLastSentAt;
+  ClientMessage::ReqCase mLastSent;
+
+  std::string mSessionToken;
+  CardHand mLegalPlays;
+  int mHands;
+};
+
+static float percentile(const std::vector<float>& sorted, double p)
+{
+  if (sorted.empty())
+    return 0.0;
+  const size_t i = std::min(sorted.size() - 1, size_t(p * sorted.size()));
+  return sorted[i];
+}
+
+void printReport(LoadStats& stats, double seconds)
+{
+  printf("%u sessions completed, %u failed, %u hands in %.2f seconds\n", stats.sessionsCompleted,
+      stats.sessionsFailed, stats.handsPlayed, seconds);
+  printf("%.2f sessions/sec, %.2f hands/sec\n\n", stats.sessionsCompleted / seconds, stats.handsPlayed / seconds);
+
+  printf("%-10s %8s %9s %9s %9s %9s %9s  (ms)\n", "response", "count", "mean", "p50", "p90", "p99", "max");
+  for (int r = 0; r < kNumResponses; ++r)
+  {
+    std::vector<float>& samples = stats.latencyMillis[r];
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (float s : samples)
+      sum += s;
+    printf("%-10s %8zu %9.2f %9.2f %9.2f %9.2f %9.2f\n", kResponseNames[r], samples.size(),
+        samples.empty() ? 0.0 : sum / samples.size(), percentile(samples, 0.5), percentile(samples, 0.9),
+        percentile(samples, 0.99), samples.empty() ? 0.0 : samples.back());
+  }
+
+  // Histograms with power of two buckets: the count of latencies below 1ms, in [1,2), [2,4), ...
+  const int kNumBuckets = 16;
+  printf("\n%-10s", "<ms");
+  for (int b = 0; b < kNumBuckets; ++b)
+    printf(" %6d", 1 << b);
+  printf("\n");
+  for (int r = 0; r < kNumResponses; ++r)
+  {
+    unsigned counts[kNumBuckets] = {0};
+    for (float s : stats.latencyMillis[r])
+    {
+      int b = 0;
+      while (b < kNumBuckets - 1 && s >= float(1 << b))
+        ++b;
+      ++counts[b];
+    }
+    printf("%-10s", kResponseNames[r]);
+    for (int b = 0; b < kNumBuckets; ++b)
+      printf(" %6u", counts[b]);
+    printf("\n");
+  }
+}
+
+int main(int argc, char** argv)
+{
+  parseArgs(argc, argv);
+
+  std::shared_ptr<Channel> channel = grpc::CreateChannel(gServer, grpc::InsecureChannelCredentials());
+  std::unique_ptr<PlayHearts::Stub> stub = PlayHearts::NewStub(channel);
+
+  std::vector<std::unique_ptr<CompletionQueue>> queues;
+  std::vector<LoadStats> stats(gNumThreads);
+  for (int i = 0; i < gNumThreads; ++i)
+    queues.emplace_back(new CompletionQueue());
+
+  const double startTime = now();
+  gRemaining = gNumSessions;
+  const RandomGenerator rng(gSeed);
+  for (int i = 0; i < gNumSessions; ++i)
+    new BotSession(stub.get(), queues[i % gNumThreads].get(), &stats[i % gNumThreads], rng.random64());
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < gNumThreads; ++i)
+  {
+    CompletionQueue* cq = queues[i].get();
+    threads.emplace_back([cq]() {
+      void* tag;
+      bool ok;
+      while (cq->Next(&tag, &ok))
+        BotSession::Dispatch(tag, ok);
+    });
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(gRemainingMutex);
+    gRemainingChanged.wait(lock, []() { return gRemaining == 0; });
+  }
+  const double seconds = now() - startTime;
+
+  for (int i = 0; i < gNumThreads; ++i)
+    queues[i]->Shutdown();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  LoadStats total;
+  for (const LoadStats& s : stats)
+    total += s;
+  printReport(total, seconds);
+
+  return total.sessionsFailed == 0 ? 0 : 1;
+}
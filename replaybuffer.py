@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+# replaybuffer.py
+
+# Lock-free reader for the replay buffer ring file written by lib/ReplayBuffer.cpp (e.g. `hearts -a replay:<path>`).
+# The four data regions are mapped as numpy memmaps with the same shapes as the dataset memmaps, so sampling a
+# batch is a single fancy-index gather per array straight out of the page cache.
+
+import sys
+import numpy as np
+
+from constants import MAIN_INPUT_SHAPE, SCORES_SHAPE, WIN_TRICK_PROBS_SHAPE, MOONPROBS_SHAPE
+
+MAGIC = b'HNNREPLY'
+VERSION = 1
+HEADER_SIZE = 4096
+RESERVED_OFFSET = 64
+COMMITTED_OFFSET = 128
+
+class ReplayBuffer:
+    def __init__(self, path):
+        header = np.memmap(path, mode='r', dtype=np.uint8, shape=(HEADER_SIZE,))
+        assert bytes(header[0:8]) == MAGIC, 'Not a replay buffer: {}'.format(path)
+        version, headerSize = np.frombuffer(header[8:16], dtype=np.uint32)
+        assert version == VERSION and headerSize == HEADER_SIZE
+        self.capacity = int(np.frombuffer(header[16:24], dtype=np.uint64)[0])
+
+        # Aligned 8 byte loads of the cursors are atomic on x86.
+        self._cursors = np.memmap(path, mode='r', dtype=np.uint64, shape=(COMMITTED_OFFSET//8 + 1,))
+
+        offset = HEADER_SIZE
+        arrays = []
+        for shape in (MAIN_INPUT_SHAPE, SCORES_SHAPE, WIN_TRICK_PROBS_SHAPE, MOONPROBS_SHAPE):
+            full = (self.capacity,) + shape
+            arrays.append(np.memmap(path, mode='r', dtype=np.float32, offset=offset, shape=full))
+            offset += 4 * int(np.prod(full))
+        self.main, self.score, self.trick, self.moon = arrays
+
+    def reserved(self):
+        return int(self._cursors[RESERVED_OFFSET//8])
+
+    def committed(self):
+        return int(self._cursors[COMMITTED_OFFSET//8])
+
+    def size(self):
+        return min(self.committed(), self.capacity)
+
+    def sample(self, batch):
+        """ Returns (mainData, scoresData, winTrickProbs, moonProbData) for up to `batch` samples chosen uniformly
+            from the published samples still in the ring. Samples that writers overwrote while we were copying
+            them out are dropped, so the result may occasionally be a little short. """
+        committed = self.committed()
+        reserved = self.reserved()
+        lowest = max(0, reserved - self.capacity)
+        if committed <= lowest:
+            return None
+        indexes = np.random.randint(lowest, committed, size=batch, dtype=np.uint64)
+        slots = indexes % np.uint64(self.capacity)
+        result = [a[slots] for a in (self.main, self.score, self.trick, self.moon)]
+
+        # A sample is intact if no writer had reserved the index that reuses its slot before we finished copying.
+        valid = indexes + np.uint64(self.capacity) >= np.uint64(self.reserved())
+        if not valid.all():
+            result = [r[valid] for r in result]
+        return tuple(result)
+
+if __name__ == '__main__':
+    buffer = ReplayBuffer(sys.argv[1])
+    print('{}: capacity {}, holding {}, {} published in total'.format(sys.argv[1], buffer.capacity, buffer.size(),
+        buffer.committed()))
@@ -0,0 +1,206 @@
+// suite.cpp
+// Generate and print position suites, and run strategies on them (see lib/PositionSuite.h).
+//
+// `suite solve` writes each position's play, expected values and time. Given the results of an earlier run with
+// --reference, it also lists the positions where the play changed (or, with --tolerance, an expected value moved
+// by more than the tolerance), compares the total time, and exits with status 1 if anything changed.
+
+#include "lib/DealCorpus.h"
+#include "lib/PositionSuite.h"
+
+#include "lib/timer.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+uint64_t gSeed = 1;
+const char* gDealsPath = nullptr;
+int gJobs = std::max(1u, std::thread::hardware_concurrency());
+const char* gOutputPath = nullptr;
+const char* gReferencePath = nullptr;
+double gTolerance = -1.0;
+
+void usage()
+{
+    const char* lines[] = {"Usage: suite [options...] <command> <args...>", "  Commands:",
+        "    generate <count> <out>     write a suite of count positions, reproducible from the seed",
+        "    print <suite>              print the positions of a suite",
+        "    solve <suite> <strategy>   run a strategy (a spec as for tournament) on every position",
+        "  Options:", "    -s,--seed <int>            the seed for generate, and for the strategy in solve (default:1)",
+        "    -d,--deals <dealIndexFile> generate positions from the deals of this corpus (default: random deals)",
+        "    -j,--jobs <int>            the number of positions solved in parallel (default: one per core)",
+        "    -o,--output <path>         write the results of solve to this file (default: stdout)",
+        "    -r,--reference <path>      compare the results of solve with these results of an earlier solve",
+        "    -t,--tolerance <points>    with --reference, also report expected values that differ by more than this",
+        "    -h,--help                  print this message", 0};
+    for (int i = 0; lines[i] != 0; ++i)
+        printf("%s\n", lines[i]);
+    exit(0);
+}
+
+void parseArgs(int argc, char** argv)
+{
+    const struct option longopts[] = {{"seed", required_argument, NULL, 's'},
+        {"deals", required_argument, NULL, 'd'}, {"jobs", required_argument, NULL, 'j'},
+        {"output", required_argument, NULL, 'o'}, {"reference", required_argument, NULL, 'r'},
+        {"tolerance", required_argument, NULL, 't'}, {"help", no_argument, NULL, 'h'}, {NULL, 0, NULL, 0}};
+
+    while (true)
+    {
+        int longindex = 0;
+        int ch = getopt_long(argc, argv, "s:d:j:o:r:t:h", longopts, &longindex);
+        if (ch == -1)
+            break;
+
+        switch (ch)
+        {
+        case 's':
+            gSeed = strtoull(optarg, 0, 10);
+            break;
+        case 'd':
+            gDealsPath = optarg;
+            break;
+        case 'j':
+            gJobs = atoi(optarg);
+            break;
+        case 'o':
+            gOutputPath = optarg;
+            break;
+        case 'r':
+            gReferencePath = optarg;
+            break;
+        case 't':
+            gTolerance = atof(optarg);
+            break;
+        case 'h':
+        default:
+            usage();
+            break;
+        }
+    }
+
+    if (gJobs <= 0)
+        usage();
+}
+
+void printPosition(size_t i, const KnowableState& state)
+{
+    printf("%zu: play %u player %u points %u,%u,%u,%u trick", i, state.PlayNumber(), state.CurrentPlayer(),
+        state.GetScoreFor(0), state.GetScoreFor(1), state.GetScoreFor(2), state.GetScoreFor(3));
+    for (unsigned j = 0; j < state.PlayInTrick(); ++j)
+        printf(" %s", NameOf(state.GetTrickPlay(j)));
+    printf("\n    hand %s\n", state.CurrentPlayersHand().AsString().c_str());
+}
+
+// Prints the differences from the reference, returning the number of positions that differ.
+int compare(const PositionSuite& suite, const std::vector<PositionResult>& results,
+    const std::vector<PositionResult>& reference)
+{
+    if (reference.size() != results.size())
+    {
+        fprintf(stderr, "The reference has %zu positions, the suite %zu\n", reference.size(), results.size());
+        exit(1);
+    }
+
+    int playsChanged = 0;
+    int valuesChanged = 0;
+    double maxDifference = 0.0;
+    double seconds = 0.0, referenceSeconds = 0.0;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const PositionResult& result = results[i];
+        const PositionResult& expected = reference[i];
+        seconds += result.seconds;
+        referenceSeconds += expected.seconds;
+
+        double difference = 0.0;
+        for (unsigned j = 0; j < std::min(result.numChoices, expected.numChoices); ++j)
+            difference = std::max(difference, double(fabs(result.expectedValue[j] - expected.expectedValue[j])));
+        maxDifference = std::max(maxDifference, difference);
+
+        const bool playChanged = result.play != expected.play || result.numChoices != expected.numChoices;
+        const bool valueChanged = gTolerance >= 0.0 && difference > gTolerance;
+        if (!playChanged && !valueChanged)
+            continue;
+
+        playsChanged += playChanged;
+        valuesChanged += valueChanged;
+        printPosition(i, suite.Position(i));
+        printf("    played %s, reference %s, largest expected value difference %.4f\n", NameOf(result.play),
+            NameOf(expected.play), difference);
+    }
+
+    printf("%zu positions: %d plays changed", results.size(), playsChanged);
+    if (gTolerance >= 0.0)
+        printf(", %d with an expected value changed by more than %g", valuesChanged, gTolerance);
+    printf(", largest expected value difference %.4f\n", maxDifference);
+    printf("Time %.3fs, reference %.3fs, ratio %.3f\n", seconds, referenceSeconds,
+        referenceSeconds > 0.0 ? seconds / referenceSeconds : 0.0);
+    return playsChanged + valuesChanged;
+}
+
+int main(int argc, char** argv)
+{
+    parseArgs(argc, argv);
+    if (optind == argc)
+        usage();
+
+    const std::string command(argv[optind++]);
+    const int numArgs = argc - optind;
+    char** args = argv + optind;
+
+    if (command == "generate" && numArgs == 2)
+    {
+        const DealCorpus* deals = gDealsPath != nullptr ? new DealCorpus(gDealsPath) : nullptr;
+        const size_t count = strtoull(args[0], 0, 10);
+        PositionSuite::Write(args[1], PositionSuite::Generate(count, gSeed, deals), gSeed);
+        printf("Wrote %zu positions with seed %llu to %s\n", count, (unsigned long long) gSeed, args[1]);
+    }
+    else if (command == "print" && numArgs == 1)
+    {
+        const PositionSuite suite(args[0]);
+        for (size_t i = 0; i < suite.Size(); ++i)
+            printPosition(i, suite.Position(i));
+    }
+    else if (command == "solve" && numArgs == 2)
+    {
+        const PositionSuite suite(args[0]);
+        const StrategyPtr strategy = makePlayer(args[1]);
+
+        const double startTime = now();
+        const std::vector<PositionResult> results = SolvePositions(suite, strategy, gJobs, gSeed);
+        const double elapsed = now() - startTime;
+
+        FILE* out = stdout;
+        if (gOutputPath != nullptr)
+        {
+            out = fopen(gOutputPath, "w");
+            if (out == nullptr)
+            {
+                fprintf(stderr, "fopen %s failed: %s\n", gOutputPath, strerror(errno));
+                exit(1);
+            }
+        }
+        WriteResults(out, results);
+        if (out != stdout)
+        {
+            fclose(out);
+            printf("Solved %zu positions with %s in %.3fs on %d jobs\n", suite.Size(), args[1], elapsed, gJobs);
+        }
+
+        if (gReferencePath != nullptr && compare(suite, results, ReadResults(gReferencePath)) != 0)
+            return 1;
+    }
+    else
+    {
+        usage();
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "gtest/gtest.h"
+
+#include "lib/Deal.h"
+#include "lib/DealCorpus.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+static std::string tempPath() {
+  char path[] = "/tmp/DealCorpusXXXXXX";
+  int fd = mkstemp(path);
+  EXPECT_NE(-1, fd);
+  close(fd);
+  return path;
+}
+
+TEST(DealCorpus, WriteAndMap) {
+  const std::string path = tempPath();
+  uint128_t deals[3] = {0, 1, Deal::RandomDealIndex()};
+  DealCorpus::Write(path, deals, 3, 7);
+
+  DealCorpus corpus(path);
+  EXPECT_TRUE(corpus.IsMapped());
+  ASSERT_EQ(3u, corpus.Size());
+  EXPECT_EQ(7u, corpus.Seed());
+  for (int i=0; i<3; ++i)
+    EXPECT_TRUE(deals[i] == corpus[i]);
+  unlink(path.c_str());
+}
+
+TEST(DealCorpus, GenerateIsReproducible) {
+  const std::string path = tempPath();
+  DealCorpus::Generate(path, 100, 42);
+  DealCorpus corpus(path);
+  ASSERT_EQ(100u, corpus.Size());
+
+  RandomGenerator rng(42);
+  for (int i=0; i<100; ++i)
+    EXPECT_TRUE(Deal::RandomDealIndex(rng) == corpus[i]);
+  unlink(path.c_str());
+}
+
+TEST(DealCorpus, ReadsText) {
+  const std::string path = tempPath();
+  FILE* f = fopen(path.c_str(), "w");
+  fprintf(f, "1f\nabc\n");
+  fclose(f);
+
+  DealCorpus corpus(path);
+  EXPECT_FALSE(corpus.IsMapped());
+  ASSERT_EQ(2u, corpus.Size());
+  EXPECT_TRUE(uint128_t(0x1f) == corpus[0]);
+  EXPECT_TRUE(uint128_t(0xabc) == corpus[1]);
+  unlink(path.c_str());
+}
+
+TEST(DealCorpus, ShardsPartition) {
+  const size_t kSize = 10;
+  size_t expectedBegin = 0;
+  for (int shard=0; shard<4; ++shard) {
+    size_t begin, end;
+    DealCorpus::ShardRange(kSize, shard, 4, begin, end);
+    EXPECT_EQ(expectedBegin, begin);
+    EXPECT_TRUE(end - begin == 2 || end - begin == 3);
+    expectedBegin = end;
+  }
+  EXPECT_EQ(kSize, expectedBegin);
+
+  int shard, numShards;
+  EXPECT_TRUE(DealCorpus::ParseShard("1/4", shard, numShards));
+  EXPECT_EQ(1, shard);
+  EXPECT_EQ(4, numShards);
+  EXPECT_FALSE(DealCorpus::ParseShard("4/4", shard, numShards));
+  EXPECT_FALSE(DealCorpus::ParseShard("1", shard, numShards));
+}
@@ -2,6 +2,8 @@
 
 #include "lib/KnowableState.h"
 #include "lib/GameState.h"
+#include "lib/RandomStrategy.h"
+#include "lib/random.h"
 
 TEST(KnowableState, nominal) {
   GameState gameState;
@@ -13,3 +15,26 @@ TEST(KnowableState, HypotheticalState) {
   KnowableState knowableState(gameState);
   GameState derived = knowableState.HypotheticalState();
 }
+
+TEST(KnowableState, PackRoundTrip) {
+  const RandomGenerator& rng = RandomGenerator::ThreadSpecific();
+  StrategyPtr random(new RandomStrategy());
+  GameState gameState;
+  for (int play=0; play<52; ++play) {
+    KnowableState knowableState(gameState);
+    KnowableState restored(knowableState.Pack());
+
+    ASSERT_EQ(restored.dealIndex(), knowableState.dealIndex());
+    ASSERT_EQ(restored.PlayNumber(), knowableState.PlayNumber());
+    ASSERT_EQ(restored.CurrentPlayer(), knowableState.CurrentPlayer());
+    ASSERT_EQ(restored.PointsPlayed(), knowableState.PointsPlayed());
+    ASSERT_EQ(restored.LegalPlays(), knowableState.LegalPlays());
+    FloatMatrix before = knowableState.AsFloatMatrix();
+    FloatMatrix after = restored.AsFloatMatrix();
+    for (int card=0; card<52; ++card)
+      for (int col=0; col<KnowableState::kNumFeaturesPerCard; ++col)
+        ASSERT_EQ(after(card, col), before(card, col));
+
+    gameState.NextPlay(random, rng);
+  }
+}
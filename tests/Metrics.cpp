@@ -0,0 +1,82 @@
+#include "gtest/gtest.h"
+
+#include "lib/Metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+TEST(Metrics, histogramBuckets) {
+  for (uint64_t v = 0; v < MetricHistogram::kSubBuckets; ++v)
+    EXPECT_EQ(v, MetricHistogram::BucketOf(v));
+
+  unsigned previous = 0;
+  for (uint64_t v : {8ul, 9ul, 15ul, 16ul, 17ul, 100ul, 1000ul, 123456789ul, 1ul << 40, ~0ul}) {
+    const unsigned bucket = MetricHistogram::BucketOf(v);
+    ASSERT_LT(bucket, MetricHistogram::kBuckets);
+    EXPECT_GE(bucket, previous);
+    previous = bucket;
+    // The value is within its bucket, and the bucket is at most 1/kSubBuckets of its lower bound wide.
+    const uint64_t lower = MetricHistogram::BucketLowerBound(bucket);
+    EXPECT_LE(lower, v);
+    if (bucket + 1 < MetricHistogram::kBuckets) {
+      const uint64_t upper = MetricHistogram::BucketLowerBound(bucket + 1);
+      EXPECT_GT(upper, v);
+      EXPECT_LE(upper - lower, lower / MetricHistogram::kSubBuckets);
+    }
+  }
+  EXPECT_EQ(MetricHistogram::kBuckets - 1, MetricHistogram::BucketOf(~0ul));
+}
+
+TEST(Metrics, histogramPercentiles) {
+  MetricHistogram histogram("test.histogram");
+  for (uint64_t v = 1; v <= 1000; ++v)
+    histogram.Record(v);
+
+  MetricHistogram::Snapshot snapshot;
+  histogram.Read(snapshot);
+  EXPECT_EQ(1000u, snapshot.count);
+  EXPECT_EQ(500500u, snapshot.sum);
+  EXPECT_NEAR(500.0, double(snapshot.Percentile(0.5)), 500.0 / MetricHistogram::kSubBuckets);
+  EXPECT_NEAR(990.0, double(snapshot.Percentile(0.99)), 990.0 / MetricHistogram::kSubBuckets);
+  EXPECT_GE(snapshot.Percentile(1.0), 1000u);
+}
+
+TEST(Metrics, countersFromManyThreads) {
+  MetricCounter counter("test.counter");
+  MetricStats stats("test.stats");
+  const int kThreads = 8;
+  const int kAdds = 10000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t)
+    threads.emplace_back([&]() {
+      for (int i = 0; i < kAdds; ++i) {
+        counter.Add();
+        stats.Record(i % 2 == 0 ? -1.0 : 3.0);
+      }
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+  EXPECT_EQ(uint64_t(kThreads * kAdds), counter.Read());
+
+  char buffer[4096];
+  FILE* out = fmemopen(buffer, sizeof(buffer), "w");
+  stats.Write(out);
+  fclose(out);
+  EXPECT_NE(nullptr, strstr(buffer, "count 80000 mean 1.0000 std 2.0000 min -1.0000 max 3.0000"));
+}
+
+TEST(Metrics, snapshotListsMetrics) {
+  MetricTimer timer("test.timer");
+  { ScopedTimer scoped(timer); }
+
+  char buffer[1 << 16];
+  FILE* out = fmemopen(buffer, sizeof(buffer), "w");
+  WriteMetrics(out);
+  fclose(out);
+  EXPECT_NE(nullptr, strstr(buffer, "# metrics at "));
+  EXPECT_NE(nullptr, strstr(buffer, "test.timer"));
+  EXPECT_NE(nullptr, strstr(buffer, "timer count 1 "));
+  EXPECT_GT(SecondsPerTick(), 0.0);
+}
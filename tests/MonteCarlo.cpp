@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+
+#include "lib/Deal.h"
+#include "lib/GameState.h"
+#include "lib/KnowableState.h"
+#include "lib/MonteCarlo.h"
+#include "lib/RandomStrategy.h"
+#include "lib/random.h"
+#include "lib/timer.h"
+
+// Plays randomly to the first position with a choice to make, since MonteCarlo does no search for forced plays.
+static void playToChoice(GameState& state, const RandomGenerator& rng) {
+  StrategyPtr random(new RandomStrategy());
+  while (state.LegalPlays().Size() == 1)
+    state.NextPlay(random, rng);
+}
+
+TEST(MonteCarlo, AnytimeSearchReturnsByDeadline) {
+  RandomGenerator rng(7);
+  Deal deck(Deal::RandomDealIndex(rng));
+  GameState state(deck);
+  playToChoice(state, rng);
+  const KnowableState knowable(state);
+
+  // Far more alternates than could finish in the budget.
+  StrategyPtr intuition(new RandomStrategy());
+  const bool kSerial = false;
+  MonteCarlo monteCarlo(intuition, 1000000, kSerial, AnnotatorPtr());
+  monteCarlo.SetMoveBudget(0.05);
+
+  const double start = now();
+  const Card play = monteCarlo.choosePlay(knowable, rng);
+  const double elapsed = delta(start);
+  EXPECT_TRUE(knowable.LegalPlays().HasCard(play));
+  EXPECT_GE(elapsed, 0.05);
+  EXPECT_LT(elapsed, 1.0);
+}
+
+TEST(MonteCarlo, ParsesMoveBudgetSpec) {
+  RandomGenerator rng(7);
+  Deal deck(Deal::RandomDealIndex(rng));
+  GameState state(deck);
+  playToChoice(state, rng);
+  const KnowableState knowable(state);
+
+  StrategyPtr player = makePlayer("random#1000000@0.05");
+  ASSERT_TRUE(dynamic_cast<MonteCarlo*>(player.get()) != nullptr);
+  const double start = now();
+  EXPECT_TRUE(knowable.LegalPlays().HasCard(player->choosePlay(knowable, rng)));
+  EXPECT_LT(delta(start), 1.0);
+}
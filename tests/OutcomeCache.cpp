@@ -0,0 +1,86 @@
+#include "gtest/gtest.h"
+
+#include "lib/Deal.h"
+#include "lib/GameState.h"
+#include "lib/KnowableState.h"
+#include "lib/OutcomeCache.h"
+#include "lib/RandomStrategy.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+// Always plays its lowest legal card, so it is deterministic.
+class LowestCardStrategy : public Strategy
+{
+public:
+  virtual Card choosePlay(const KnowableState& state, const RandomGenerator& rng) const {
+    ++mPlays;
+    return state.LegalPlays().FirstCard();
+  }
+
+  virtual Card predictOutcomes(const KnowableState& state, const RandomGenerator& rng, float playExpectedValue[13]) const {
+    return choosePlay(state, rng);
+  }
+
+  virtual std::string Fingerprint() const { return "lowest"; }
+
+  mutable int mPlays = 0;
+};
+
+TEST(OutcomeCache, SkipsReplayOfDeterministicTable) {
+  LowestCardStrategy* lowest = new LowestCardStrategy();
+  StrategyPtr player(lowest);
+  StrategyPtr players[4] = {player, player, player, player};
+  const uint128_t deal = Deal::RandomDealIndex();
+  RandomGenerator rng(1);
+
+  OutcomeCache cache;
+  GameOutcome first = cache.PlayGame(deal, players, rng);
+  const int plays = lowest->mPlays;
+  EXPECT_LT(0, plays);
+  GameOutcome second = cache.PlayGame(deal, players, rng);
+  EXPECT_EQ(plays, lowest->mPlays);
+  EXPECT_EQ(1u, cache.Hits());
+
+  Deal deck(deal);
+  GameState state(deck);
+  GameOutcome played = state.PlayGame(players, rng);
+  for (int i=0; i<4; ++i) {
+    EXPECT_EQ(played.ZeroMeanStandardScore(i), second.ZeroMeanStandardScore(i));
+    EXPECT_EQ(played.PointTricks(i), second.PointTricks(i));
+  }
+  EXPECT_EQ(played.shotTheMoon(), second.shotTheMoon());
+}
+
+TEST(OutcomeCache, IgnoresRandomPlayers) {
+  StrategyPtr lowest(new LowestCardStrategy());
+  StrategyPtr random(new RandomStrategy());
+  StrategyPtr players[4] = {lowest, random, lowest, lowest};
+  EXPECT_EQ("", OutcomeCache::Key(0, players));
+
+  OutcomeCache cache;
+  cache.PlayGame(0, players, RandomGenerator(2));
+  EXPECT_EQ(0u, cache.Size());
+}
+
+TEST(OutcomeCache, Persists) {
+  char path[] = "/tmp/OutcomeCacheXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(-1, fd);
+  close(fd);
+
+  StrategyPtr player(new LowestCardStrategy());
+  StrategyPtr players[4] = {player, player, player, player};
+  const std::string key = OutcomeCache::Key(12345, players);
+  GameOutcome outcome;
+  {
+    OutcomeCache cache(path);
+    EXPECT_FALSE(cache.Lookup(key, outcome));
+    cache.PlayGame(12345, players, RandomGenerator(3));
+  }
+  OutcomeCache reloaded(path);
+  EXPECT_EQ(1u, reloaded.Size());
+  EXPECT_TRUE(reloaded.Lookup(key, outcome));
+  unlink(path);
+}
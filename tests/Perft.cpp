@@ -0,0 +1,83 @@
+#include "gtest/gtest.h"
+
+#include "lib/Deal.h"
+#include "lib/GameState.h"
+#include "lib/Perft.h"
+#include "lib/RandomStrategy.h"
+#include "lib/math.h"
+#include "lib/random.h"
+
+static const char* kDealIndex = "9a100f10507bdecf4d3bded7";
+
+static GameState positionAt(unsigned playNumber) {
+  const RandomGenerator rng(1);
+  GameState state{Deal(parseHex128(kDealIndex))};
+  StrategyPtr random(new RandomStrategy());
+  while (state.PlayNumber() < playNumber)
+    state.NextPlay(random, rng);
+  return state;
+}
+
+// Visits every position to depth, checking the first trick and leading rules against the legal plays.
+static void checkRules(const GameState& state, unsigned depth) {
+  if (depth == 0 || state.Done())
+    return;
+  const CardHand plays = state.LegalPlays();
+  const CardHand& hand = state.CurrentPlayersHand();
+  ASSERT_GT(plays.Size(), 0u);
+  const bool onlyPoints = hand.NonPointCards().Size() == 0;
+  if (state.PlayNumber() < 4 && !onlyPoints) {
+    EXPECT_EQ(0u, plays.CountCardsWithMask(kPointCardsMask)) << "points played in the first trick";
+  }
+  if (state.PlayInTrick() == 0 && state.PointsPlayed() == 0 && !onlyPoints) {
+    EXPECT_EQ(0u, plays.CountCardsWithMask(kPointCardsMask)) << "points led before any were played";
+  }
+
+  for (CardHand remaining = plays; remaining.Size() > 0;) {
+    const Card card = remaining.FirstCard();
+    remaining.RemoveCard(card);
+    GameState next(state);
+    next.PlayCard(card);
+    checkRules(next, depth - 1);
+  }
+}
+
+TEST(Perft, knownCountsFromDeal) {
+  // Any change to these counts is a change to the rules of legal play.
+  const uint64_t expected[] = {1, 1, 2, 10, 40, 352, 1121, 2785, 6696};
+  const GameState state = positionAt(0);
+  for (unsigned depth = 0; depth < sizeof(expected) / sizeof(expected[0]); ++depth)
+    EXPECT_EQ(expected[depth], Perft(state, depth)) << "depth " << depth;
+}
+
+TEST(Perft, bulkCountingMatchesPlayingEveryCard) {
+  const GameState state = positionAt(20);
+  for (unsigned depth = 1; depth <= 6; ++depth)
+    EXPECT_EQ(Perft(state, depth, false), Perft(state, depth, true));
+}
+
+TEST(Perft, parallelMatchesSerial) {
+  const GameState state = positionAt(20);
+  const uint64_t serial = Perft(state, 6);
+  EXPECT_EQ(serial, ParallelPerft(state, 6, 2, 4));
+  EXPECT_EQ(serial, ParallelPerft(state, 6, 1, 3, false));
+}
+
+TEST(Perft, divisionsSumToPerft) {
+  const GameState state = positionAt(20);
+  uint64_t sum = 0;
+  for (const PerftDivision& division : PerftDivide(state, 5, 2, 2)) {
+    EXPECT_TRUE(state.LegalPlays().HasCard(division.play));
+    sum += division.leaves;
+  }
+  EXPECT_EQ(Perft(state, 5), sum);
+}
+
+TEST(Perft, countsEndOfGameAsOneLeaf) {
+  const GameState state = positionAt(50);
+  EXPECT_EQ(Perft(state, 2), Perft(state, 10));
+}
+
+TEST(Perft, legalPlaysFollowTheFirstTrickAndLeadRules) {
+  checkRules(positionAt(0), 9);
+}
@@ -0,0 +1,98 @@
+#include "gtest/gtest.h"
+
+#include "lib/PositionSuite.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static std::string tempPath(const char* name) {
+  return std::string("/tmp/") + name + "." + std::to_string(getpid());
+}
+
+TEST(PositionSuite, generateIsReproducible) {
+  const std::vector<PackedKnowableState> a = PositionSuite::Generate(50, 7);
+  const std::vector<PackedKnowableState> b = PositionSuite::Generate(50, 7);
+  const std::vector<PackedKnowableState> c = PositionSuite::Generate(50, 8);
+  ASSERT_EQ(50u, a.size());
+  ASSERT_EQ(50u, b.size());
+  EXPECT_EQ(0, memcmp(a.data(), b.data(), a.size() * sizeof(PackedKnowableState)));
+  EXPECT_NE(0, memcmp(a.data(), c.data(), a.size() * sizeof(PackedKnowableState)));
+
+  for (const PackedKnowableState& packed : a) {
+    const KnowableState state(packed);
+    EXPECT_GT(state.LegalPlays().Size(), 1u);
+    EXPECT_LT(state.PointsPlayed(), 26u);
+  }
+}
+
+TEST(PositionSuite, writeAndRead) {
+  const std::vector<PackedKnowableState> positions = PositionSuite::Generate(20, 3);
+  const std::string path = tempPath("PositionSuite.suite");
+  PositionSuite::Write(path, positions, 3);
+
+  const PositionSuite suite(path);
+  unlink(path.c_str());
+  ASSERT_EQ(positions.size(), suite.Size());
+  EXPECT_EQ(3u, suite.Seed());
+  for (size_t i = 0; i < suite.Size(); ++i) {
+    // Everything but the deal index is stored.
+    PackedKnowableState expected = positions[i];
+    expected.dealIndexLo = 0;
+    expected.dealIndexHi = 0;
+    EXPECT_EQ(0, memcmp(&expected, &suite.Packed(i), sizeof(PackedKnowableState)));
+    const PackedKnowableState repacked = suite.Position(i).Pack();
+    EXPECT_EQ(0, memcmp(&expected, &repacked, sizeof(PackedKnowableState)));
+  }
+}
+
+TEST(PositionSuite, solveIsIndependentOfThreads) {
+  const std::string path = tempPath("PositionSuite.suite");
+  PositionSuite::Write(path, PositionSuite::Generate(12, 5), 5);
+  const PositionSuite suite(path);
+  unlink(path.c_str());
+
+  const StrategyPtr strategy = makePlayer("random#10");
+  const std::vector<PositionResult> serial = SolvePositions(suite, strategy, 1, 9);
+  const std::vector<PositionResult> parallel = SolvePositions(suite, strategy, 3, 9);
+  ASSERT_EQ(suite.Size(), serial.size());
+  ASSERT_EQ(suite.Size(), parallel.size());
+  for (size_t i = 0; i < suite.Size(); ++i) {
+    EXPECT_EQ(serial[i].play, parallel[i].play);
+    EXPECT_EQ(suite.Position(i).LegalPlays().Size(), serial[i].numChoices);
+    EXPECT_TRUE(suite.Position(i).LegalPlays().HasCard(serial[i].play));
+    for (unsigned j = 0; j < serial[i].numChoices; ++j)
+      EXPECT_EQ(serial[i].expectedValue[j], parallel[i].expectedValue[j]);
+  }
+}
+
+TEST(PositionSuite, resultsRoundTrip) {
+  std::vector<PositionResult> results(2);
+  results[0].play = 5;
+  results[0].numChoices = 3;
+  results[0].seconds = 0.25;
+  results[0].expectedValue[0] = 1.5f;
+  results[0].expectedValue[1] = -2.25f;
+  results[0].expectedValue[2] = 13.0f;
+  results[1].play = 51;
+  results[1].numChoices = 1;
+  results[1].seconds = 0.001;
+  results[1].expectedValue[0] = 0.0f;
+
+  const std::string path = tempPath("PositionSuite.tsv");
+  FILE* f = fopen(path.c_str(), "w");
+  ASSERT_NE(nullptr, f);
+  WriteResults(f, results);
+  fclose(f);
+  const std::vector<PositionResult> read = ReadResults(path);
+  unlink(path.c_str());
+
+  ASSERT_EQ(results.size(), read.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].play, read[i].play);
+    EXPECT_EQ(results[i].numChoices, read[i].numChoices);
+    EXPECT_NEAR(results[i].seconds, read[i].seconds, 1e-6);
+    for (unsigned j = 0; j < results[i].numChoices; ++j)
+      EXPECT_FLOAT_EQ(results[i].expectedValue[j], read[i].expectedValue[j]);
+  }
+}
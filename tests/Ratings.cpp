@@ -0,0 +1,45 @@
+#include "gtest/gtest.h"
+
+#include "lib/Ratings.h"
+
+TEST(Ratings, EqualPlayersRateEqually) {
+  Ratings ratings(3);
+  for (int i=0; i<20; ++i) {
+    ratings.AddResult(0, 1, 0.5);
+    ratings.AddResult(1, 2, 0.5);
+    ratings.AddResult(2, 0, 0.5);
+  }
+  ratings.Fit();
+  for (int i=0; i<3; ++i)
+    EXPECT_NEAR(0.0, ratings.Elo(i), 1e-6);
+}
+
+TEST(Ratings, RecoversKnownGap) {
+  // Player 0 wins 3 of 4 games, i.e. odds of 3, which is 400*log10(3) = 190.8 Elo.
+  Ratings ratings(2);
+  for (int i=0; i<1000; ++i) {
+    ratings.AddResult(0, 1, 1.0);
+    ratings.AddResult(0, 1, 1.0);
+    ratings.AddResult(0, 1, 1.0);
+    ratings.AddResult(0, 1, 0.0);
+  }
+  ratings.Fit();
+  EXPECT_NEAR(190.8, ratings.Elo(0) - ratings.Elo(1), 1.0);
+  EXPECT_LT(ratings.EloError(0), 20.0);
+}
+
+TEST(Ratings, UnbeatenPlayerStaysFinite) {
+  Ratings ratings(2);
+  ratings.AddResult(0, 1, 1.0);
+  ratings.Fit();
+  EXPECT_GT(ratings.Elo(0), ratings.Elo(1));
+  EXPECT_LT(ratings.Elo(0), 1000.0);
+
+  // Adding a player later keeps the earlier results.
+  const int p = ratings.AddPlayer();
+  EXPECT_EQ(2, p);
+  ratings.AddResult(2, 0, 1.0);
+  ratings.Fit();
+  EXPECT_GT(ratings.Elo(2), ratings.Elo(1));
+  EXPECT_EQ(2.0, ratings.Games(0));
+}
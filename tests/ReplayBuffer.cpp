@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+
+#include "lib/ReplayBuffer.h"
+#include "lib/random.h"
+
+#include <unistd.h>
+
+static void AppendSample(ReplayBuffer& buffer, float value)
+{
+  FloatMatrix mainData(kCardsPerDeck, KnowableState::kNumFeaturesPerCard);
+  mainData.setConstant(value);
+  FloatVector scoreData(kCardsPerDeck);
+  scoreData.setConstant(value);
+  FloatVector trickData(kCardsPerDeck);
+  trickData.setConstant(value);
+  FloatMatrix moonData(kCardsPerDeck, 3);
+  moonData.setConstant(value);
+  buffer.Append(mainData, scoreData, trickData, moonData);
+}
+
+TEST(ReplayBuffer, RingWrapsAndReopens) {
+  char path[] = "/tmp/replayXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(fd, -1);
+  close(fd);
+  unlink(path);
+
+  const uint64_t kCapacity = 4;
+  {
+    ReplayBuffer buffer(path, kCapacity);
+    ASSERT_EQ(buffer.Capacity(), kCapacity);
+    ASSERT_EQ(buffer.Size(), 0u);
+
+    const RandomGenerator& rng = RandomGenerator::ThreadSpecific();
+    uint64_t indexes[8];
+    ASSERT_FALSE(buffer.Sample(8, rng, indexes));
+
+    for (int i=0; i<6; ++i)
+      AppendSample(buffer, float(i));
+    ASSERT_EQ(buffer.Committed(), 6u);
+    ASSERT_EQ(buffer.Size(), kCapacity);
+
+    ASSERT_TRUE(buffer.Sample(8, rng, indexes));
+    for (int i=0; i<8; ++i) {
+      ASSERT_GE(indexes[i], 2u);
+      ASSERT_LT(indexes[i], 6u);
+      ASSERT_TRUE(buffer.StillValid(indexes[i]));
+      const uint64_t slot = buffer.Slot(indexes[i]);
+      ASSERT_EQ(buffer.MainData(slot)[0], float(indexes[i]));
+      ASSERT_EQ(buffer.MoonData(slot)[kCardsPerDeck*3-1], float(indexes[i]));
+    }
+    ASSERT_FALSE(buffer.StillValid(1));
+  }
+
+  {
+    // An existing file keeps its capacity and contents
+    ReplayBuffer buffer(path);
+    ASSERT_EQ(buffer.Capacity(), kCapacity);
+    ASSERT_EQ(buffer.Committed(), 6u);
+    ASSERT_EQ(buffer.ScoreData(buffer.Slot(5))[0], 5.0f);
+  }
+
+  unlink(path);
+}
@@ -0,0 +1,42 @@
+#include "gtest/gtest.h"
+
+#include "lib/Sprt.h"
+#include "lib/random.h"
+
+#include <math.h>
+
+// A unit normal sample from two uniforms (Box-Muller)
+static double normal(const RandomGenerator& rng)
+{
+  const double kScale = 1.0 / 18446744073709551616.0;
+  const double u1 = (rng.random64() + 1.0) * kScale;
+  const double u2 = rng.random64() * kScale;
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+TEST(Sprt, AcceptsH1WhenClearlyBetter) {
+  RandomGenerator rng(1);
+  Sprt sprt(0.0, 0.5);
+  Sprt::Decision decision = Sprt::kContinue;
+  for (int i=0; i<10000 && decision == Sprt::kContinue; ++i)
+    decision = sprt.Add(1.0 + normal(rng));
+  EXPECT_EQ(Sprt::kAcceptH1, decision);
+  EXPECT_LT(sprt.Count(), 200);
+}
+
+TEST(Sprt, AcceptsH0WhenEqual) {
+  RandomGenerator rng(2);
+  Sprt sprt(0.0, 0.5);
+  Sprt::Decision decision = Sprt::kContinue;
+  for (int i=0; i<10000 && decision == Sprt::kContinue; ++i)
+    decision = sprt.Add(-0.25 + normal(rng));
+  EXPECT_EQ(Sprt::kAcceptH0, decision);
+}
+
+TEST(Sprt, WaitsForMinimumSamples) {
+  Sprt sprt(0.0, 0.5, 0.05, 0.05, 20);
+  for (int i=0; i<19; ++i)
+    EXPECT_EQ(Sprt::kContinue, sprt.Add(i % 2 ? 10.0 : 9.0));
+  EXPECT_EQ(Sprt::kAcceptH1, sprt.Add(10.0));
+  EXPECT_DOUBLE_EQ(9.5, sprt.Mean());
+}
@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+
+#include "lib/Trace.h"
+
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+static std::string readFile(const std::string& path) {
+  std::string contents;
+  FILE* f = fopen(path.c_str(), "r");
+  if (f == nullptr)
+    return contents;
+  char buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    contents.append(buffer, n);
+  fclose(f);
+  return contents;
+}
+
+static size_t countOf(const std::string& s, const std::string& what) {
+  size_t count = 0;
+  for (size_t at = s.find(what); at != std::string::npos; at = s.find(what, at + 1))
+    ++count;
+  return count;
+}
+
+TEST(Trace, spansOfEveryThreadAreWritten) {
+  // Spans before tracing starts are not recorded.
+  { TraceSpan span("test.before"); }
+
+  const std::string path = "/tmp/Trace.json." + std::to_string(getpid());
+  StartTracing(path.c_str());
+  {
+    TraceSpan span("test.outer");
+    span.SetArg("items", 42);
+    { TraceSpan inner("test.inner"); }
+  }
+  std::thread([]() {
+    for (int i = 0; i < 3; ++i) {
+      TraceSpan span("test.worker");
+    }
+  }).join();
+
+  WriteTrace(path.c_str());
+  const std::string trace = readFile(path);
+  unlink(path.c_str());
+
+  EXPECT_EQ(0u, trace.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": ["));
+  EXPECT_EQ(0u, countOf(trace, "test.before"));
+  EXPECT_EQ(1u, countOf(trace, "\"name\": \"test.outer\""));
+  EXPECT_EQ(1u, countOf(trace, "\"name\": \"test.inner\""));
+  EXPECT_EQ(3u, countOf(trace, "\"name\": \"test.worker\""));
+  EXPECT_EQ(1u, countOf(trace, "\"args\": {\"items\": 42}"));
+  EXPECT_LE(2u, countOf(trace, "\"thread_name\""));
+  EXPECT_EQ(trace.size() - 4, trace.rfind("\n]}\n"));
+}
@@ -74,3 +74,143 @@ TEST(random, range128bot8Bits) {
   printf("range128bot8Bits %f %f\n", lo, hi);
 }
 
+
+TEST(random, seeded) {
+  RandomGenerator a(42);
+  RandomGenerator b(42);
+  RandomGenerator c(43);
+  int sameAsC = 0;
+  for (int i=0; i<100; ++i) {
+    uint64_t r = a.random64();
+    EXPECT_EQ(r, b.random64());
+    if (r == c.random64())
+      ++sameAsC;
+  }
+  EXPECT_EQ(0, sameAsC);
+}
+
+TEST(random, philoxKnownAnswers) {
+  // Known answer vectors of Philox4x32-10 from the Random123 distribution.
+  const uint32_t counters[3][4] = {
+    {0, 0, 0, 0}, {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+  const uint32_t keys[3][2] = {{0, 0}, {0xffffffff, 0xffffffff}, {0xa4093822, 0x299f31d0}};
+  const uint32_t expected[3][4] = {
+    {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+    {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+    {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+  for (int i=0; i<3; ++i) {
+    uint32_t out[4];
+    RandomGenerator::PhiloxBlock(counters[i], keys[i], out);
+    for (int j=0; j<4; ++j)
+      EXPECT_EQ(expected[i][j], out[j]) << "vector " << i << " word " << j;
+  }
+}
+
+TEST(random, outputsAreBlocksOfTheCounter) {
+  const uint64_t seed = 0x299f31d0a4093822ul;
+  const uint64_t stream = 0x0370734413198a2eul;
+  RandomGenerator gen(seed, stream);
+  const uint32_t key[2] = {uint32_t(seed), uint32_t(seed >> 32)};
+  for (uint64_t block=0; block<5; ++block) {
+    const uint32_t counter[4] = {uint32_t(block), uint32_t(block >> 32), uint32_t(stream), uint32_t(stream >> 32)};
+    uint32_t out[4];
+    RandomGenerator::PhiloxBlock(counter, key, out);
+    EXPECT_EQ((uint64_t(out[1]) << 32) | out[0], gen.random64());
+    EXPECT_EQ((uint64_t(out[3]) << 32) | out[2], gen.random64());
+  }
+}
+
+TEST(random, streams) {
+  RandomGenerator a(42, 0);
+  RandomGenerator b(42, 1);
+  RandomGenerator c(42);
+  int sameAsB = 0;
+  for (int i=0; i<100; ++i) {
+    uint64_t r = a.random64();
+    EXPECT_EQ(r, c.random64());
+    if (r == b.random64())
+      ++sameAsB;
+  }
+  EXPECT_EQ(0, sameAsB);
+}
+
+TEST(random, fillMatchesRandom64) {
+  for (unsigned offset : {0u, 1u, 5u, 8u, 13u}) {
+    RandomGenerator a(7, 3);
+    RandomGenerator b(7, 3);
+    for (unsigned i=0; i<offset; ++i)
+      EXPECT_EQ(a.random64(), b.random64());
+    uint64_t bulk[37];
+    a.Fill(bulk, 37);
+    for (unsigned i=0; i<37; ++i)
+      EXPECT_EQ(b.random64(), bulk[i]) << "offset " << offset << " output " << i;
+    EXPECT_EQ(b.random64(), a.random64());
+  }
+}
+
+TEST(random, advanceJumpsAhead) {
+  for (uint64_t skip : {0ul, 1ul, 3ul, 8ul, 1000ul, 1000003ul}) {
+    RandomGenerator a(11);
+    RandomGenerator b(11);
+    a.random64();
+    b.random64();
+    b.Advance(skip);
+    for (uint64_t i=0; i<std::min(skip, uint64_t(2000)); ++i)
+      a.random64();
+    if (skip > 2000)
+      a.Advance(skip - 2000);
+    EXPECT_EQ(a.Position(), b.Position());
+    EXPECT_EQ(a.random64(), b.random64()) << "skip " << skip;
+  }
+}
+
+TEST(random, boundedRangeThresholds) {
+  for (uint64_t range : {1ul, 2ul, 3ul, 7ul, 13ul, 52ul, 1000ul, (1ul << 63) + 1, ~0ul}) {
+    const BoundedRange64 bounded(range);
+    const uint128_t twoTo64 = uint128_t(1) << 64;
+    EXPECT_EQ(uint64_t(twoTo64 % range), bounded.threshold) << range;
+  }
+  const uint128_t D = possibleDistinguishableDeals();
+  const BoundedRange128 deals(D);
+  // 2^128 mod D, as (2^128 - 1) mod D + 1, reduced.
+  EXPECT_EQ((RandomGenerator::MAX128 % D + 1) % D, deals.threshold);
+  EXPECT_EQ(0u, BoundedRange128(uint128_t(1) << 100).threshold);
+}
+
+TEST(random, boundedRangesMatchPlainRanges) {
+  for (uint64_t range : {1ul, 3ul, 13ul, 52ul, 1ul << 40, ~0ul - 5}) {
+    RandomGenerator a(5);
+    RandomGenerator b(5);
+    const BoundedRange64 bounded(range);
+    for (int i=0; i<1000; ++i) {
+      const uint64_t r = a.range64(range);
+      EXPECT_LT(r, range);
+      EXPECT_EQ(r, b.range64(bounded));
+    }
+  }
+  for (uint128_t range : {uint128_t(1), uint128_t(1000), possibleDistinguishableDeals(), RandomGenerator::MAX128 / 3}) {
+    RandomGenerator a(6);
+    RandomGenerator b(6);
+    const BoundedRange128 bounded(range);
+    for (int i=0; i<1000; ++i) {
+      const uint128_t r = a.range128(range);
+      EXPECT_LT(r, range);
+      EXPECT_EQ(r, b.range128(bounded));
+    }
+  }
+}
+
+TEST(random, range64Uniform) {
+  RandomGenerator gen(9);
+  const unsigned kRange = 13;
+  const BoundedRange64 bounded(kRange);
+  unsigned bins[kRange] = {};
+  const int kIterations = 130000;
+  for (int i=0; i<kIterations; ++i)
+    ++bins[gen.range64(bounded)];
+  for (unsigned i=0; i<kRange; ++i) {
+    const double scaled = double(bins[i]) * kRange / kIterations;
+    EXPECT_GT(scaled, 0.97);
+    EXPECT_LT(scaled, 1.03);
+  }
+}
@@ -1,6 +1,11 @@
 #include "lib/Tournament.h"
+#include "lib/DealCorpus.h"
 #include "lib/GameState.h"
+#include "lib/Metrics.h"
 #include "lib/MonteCarlo.h"
+#include "lib/OutcomeCache.h"
+#include "lib/Throughput.h"
+#include "lib/Trace.h"
 
 #include "lib/math.h"
 #include "lib/random.h"
@@ -9,6 +14,7 @@
 #include <algorithm>
 #include <getopt.h>
 #include <string>
+#include <thread>
 
 enum PlayerRole
 {
@@ -24,6 +30,21 @@ StrategyPtr gChampion;
 
 bool gSaveMoonDeals = true;
 bool gQuiet = false;
+int gJobs = 0;
+uint64_t gSeed = 0;
+const char* gResultsPath = nullptr;
+Sprt* gSprt = nullptr;
+double gSprtBounds[2] = {0.0, 0.0};
+double gAlpha = 0.05;
+double gBeta = 0.05;
+const char* gCachePath = nullptr;
+bool gBenchmark = false;
+const char* gBenchmarkPath = nullptr;
+const char* gTracePath = nullptr;
+
+// The fixed workload of --benchmark, unless --games, --seed or --deals say otherwise.
+const int kBenchmarkMatches = 16;
+const uint64_t kBenchmarkSeed = 1;
 
 const char* PlayerName(PlayerRole role) { return role == kChampion ? "Champion" : "Opponent"; }
 
@@ -35,7 +56,23 @@ void usage()
         "(default:savemodel)",
         "    -o,--opponent <strategy>   the strategy to use for the `opponent` (default:random)",
         "    -c,--champion <strategy>   the strategy to use for the `champion` (default: simple)",
-        "    -d,--deals <dealIndexFile> a file containing deal indexes to play from (default: choose deals at random)",
+        "    -d,--deals <dealIndexFile> a deal corpus, or a text file of hex deal indexes, to play from",
+        "                               (default: choose deals at random)",
+        "    --shard <k>/<n>            play only the k-th of n equal slices of the deals, e.g. 0/4 ... 3/4",
+        "    -j,--jobs <int>            play games in parallel on this many worker threads (default: serial)",
+        "    -s,--seed <int>            the seed for the per game random generators with --jobs (default: random)",
+        "    -r,--results <path>        with --jobs, append one line per game to this file",
+        "    --sprt <s0>,<s1>           stop as soon as a sequential probability ratio test decides between a",
+        "                               champion advantage of s0 and of s1 points per game (e.g. 0,0.5)",
+        "    --alpha <p>, --beta <p>    the SPRT false positive and false negative rates, 0 < p < 0.5 (default:0.05)",
+        "    --cache <path>             reuse (and record) the outcomes of games in which every player is a",
+        "                               deterministic intuition, e.g. a model without rollouts",
+        "    --benchmark[=<path>]       play a fixed workload in parallel (16 matches of seeded deals, seed 1, one",
+        "                               job per hardware thread) and write its throughput as JSON to path, or to",
+        "                               stdout instead of the results; not with --sprt or --cache",
+        "    --trace <path>             write a Chrome trace (for chrome://tracing or ui.perfetto.dev) of where",
+        "                               every thread spends its time to path at exit",
+        "    -q,--quiet                 only print the final result",
         "    -h,--help                  print this message", 0};
     for (int i = 0; lines[i] != 0; ++i)
         printf("%s\n", lines[i]);
@@ -43,42 +80,31 @@ void usage()
 }
 
 int gNumMatches;
-uint128_t* gDeals;
+const uint128_t* gDeals;
+DealCorpus* gCorpus;
+const char* gDealsPath = nullptr;
+const char* gShardSpec = nullptr;
+int gFirstMatch = 0;
 
 const void randomDeals(int n)
 {
+    // A benchmark's deals are drawn from its seed, so that every run plays the same ones.
+    const RandomGenerator seeded(gSeed);
+    const RandomGenerator& rng = gBenchmark ? seeded : RandomGenerator::ThreadSpecific();
     gNumMatches = n;
-    gDeals = new uint128_t[gNumMatches];
+    uint128_t* deals = new uint128_t[gNumMatches];
     for (int i = 0; i < gNumMatches; ++i)
-        gDeals[i] = Deal::RandomDealIndex();
-}
-
-void trim(char* line)
-{
-    int len = strlen(line);
-    while (isspace(line[len - 1]))
-    {
-        --len;
-        line[len] = 0;
-    }
+        deals[i] = Deal::RandomDealIndex(rng);
+    gDeals = deals;
 }
 
 const void readDeals(const char* path)
 {
-    const int kMaxLines = 1000;
-    gDeals = new uint128_t[kMaxLines];
-    FILE* f = fopen(path, "r");
-    char* line = NULL;
-    size_t linecap = 0;
-    ssize_t linelen;
-    int i = 0;
-    while ((linelen = getline(&line, &linecap, f)) > 0)
-    {
-        trim(line);
-        gDeals[i++] = parseHex128(line);
-        printf("Using deal %s -> %s\n", line, asHexString(gDeals[i - 1]).c_str());
-    }
-    gNumMatches = i;
+    gCorpus = new DealCorpus(path);
+    gDeals = gCorpus->Deals();
+    gNumMatches = gCorpus->Size();
+    if (!gBenchmark)
+        printf("Using %d deals from %s\n", gNumMatches, path);
 }
 
 void parseArgs(int argc, char** argv)
@@ -86,13 +112,20 @@ void parseArgs(int argc, char** argv)
     const struct option longopts[] = {{"model", required_argument, NULL, 'm'}, {"games", required_argument, NULL, 'g'},
         {"opponent", required_argument, NULL, 'o'}, {"champion", required_argument, NULL, 'c'},
         {"deals", required_argument, NULL, 'd'}, {"quiet", no_argument, NULL, 'q'}, {"help", no_argument, NULL, 'h'},
+        {"jobs", required_argument, NULL, 'j'}, {"seed", required_argument, NULL, 's'},
+        {"results", required_argument, NULL, 'r'}, {"sprt", required_argument, NULL, 'S'},
+        {"alpha", required_argument, NULL, 'A'}, {"beta", required_argument, NULL, 'B'},
+        {"cache", required_argument, NULL, 'K'}, {"shard", required_argument, NULL, 'H'},
+        {"benchmark", optional_argument, NULL, 'M'}, {"trace", required_argument, NULL, 'T'},
         {NULL, 0, NULL, 0}};
 
+    int games = -1;
+
     while (true)
     {
 
         int longindex = 0;
-        int ch = getopt_long(argc, argv, "m:g:o:c:d:qh", longopts, &longindex);
+        int ch = getopt_long(argc, argv, "m:g:o:c:d:qj:s:r:h", longopts, &longindex);
         if (ch == -1)
         {
             break;
@@ -112,13 +145,13 @@ void parseArgs(int argc, char** argv)
         }
         case 'g':
         {
-            randomDeals(atoi(optarg));
+            games = atoi(optarg);
+            gDealsPath = nullptr;
             break;
         }
         case 'd':
         {
-            readDeals(optarg);
-            gSaveMoonDeals = false;
+            gDealsPath = optarg;
             break;
         }
         case 'q':
@@ -126,6 +159,62 @@ void parseArgs(int argc, char** argv)
             gQuiet = true;
             break;
         }
+        case 'j':
+        {
+            gJobs = atoi(optarg);
+            break;
+        }
+        case 's':
+        {
+            gSeed = strtoull(optarg, 0, 10);
+            break;
+        }
+        case 'r':
+        {
+            gResultsPath = optarg;
+            break;
+        }
+        case 'S':
+        {
+            if (sscanf(optarg, "%lf,%lf", &gSprtBounds[0], &gSprtBounds[1]) != 2 || gSprtBounds[0] == gSprtBounds[1])
+                usage();
+            break;
+        }
+        case 'A':
+        {
+            gAlpha = atof(optarg);
+            if (!(gAlpha > 0.0 && gAlpha < 0.5))
+                usage();
+            break;
+        }
+        case 'B':
+        {
+            gBeta = atof(optarg);
+            if (!(gBeta > 0.0 && gBeta < 0.5))
+                usage();
+            break;
+        }
+        case 'K':
+        {
+            gCachePath = optarg;
+            break;
+        }
+        case 'H':
+        {
+            gShardSpec = optarg;
+            break;
+        }
+        case 'M':
+        {
+            gBenchmark = true;
+            gBenchmarkPath = optarg;
+            break;
+        }
+        case 'T':
+        {
+            gTracePath = optarg;
+            break;
+        }
         case 'h':
         default:
         {
@@ -135,9 +224,41 @@ void parseArgs(int argc, char** argv)
         }
     }
 
-    if (gDeals == 0)
+    if (gBenchmark)
+    {
+        // A fixed workload: every game is played, none stopped early or read from a cache.
+        if (gSprtBounds[0] != gSprtBounds[1] || gCachePath != nullptr)
+            usage();
+        gQuiet = true;
+        gSaveMoonDeals = false;
+        if (gSeed == 0)
+            gSeed = kBenchmarkSeed;
+        if (gJobs <= 0)
+            gJobs = std::thread::hardware_concurrency();
+    }
+
+    if (gDealsPath != nullptr)
+    {
+        readDeals(gDealsPath);
+        gSaveMoonDeals = false;
+    }
+    else
     {
-        randomDeals(1);
+        randomDeals(games >= 0 ? games : gBenchmark ? kBenchmarkMatches : 1);
+    }
+
+    if (gShardSpec != nullptr)
+    {
+        int shard, numShards;
+        if (!DealCorpus::ParseShard(gShardSpec, shard, numShards))
+            usage();
+        size_t begin, end;
+        DealCorpus::ShardRange(gNumMatches, shard, numShards, begin, end);
+        gFirstMatch = begin;
+        gDeals += begin;
+        gNumMatches = end - begin;
+        if (!gBenchmark)
+            printf("Shard %d of %d: deals %zu to %zu\n", shard, numShards, begin, end - 1);
     }
 }
 
@@ -145,13 +266,51 @@ void parseArgs(int argc, char** argv)
 int main(int argc, char** argv)
 {
     parseArgs(argc, argv);
+    StartMetricsReporter(nullptr, 0.0);
+    // kill -USR1 writes a metrics snapshot to stderr.
+    if (gTracePath != nullptr)
+        StartTracing(gTracePath);
 
     gChampion = makePlayer(gChampionStr);
     gOpponent = makePlayer(gOpponentStr);
 
     Tournament tournament(gChampion, gOpponent, gQuiet, gSaveMoonDeals);
+    tournament.setFirstMatch(gFirstMatch);
+
+    if (gSprtBounds[0] != gSprtBounds[1])
+    {
+        gSprt = new Sprt(gSprtBounds[0], gSprtBounds[1], gAlpha, gBeta);
+        tournament.setStoppingRule(gSprt);
+    }
 
-    tournament.runOneTournament(gNumMatches, gDeals);
+    if (gCachePath != nullptr)
+        tournament.setOutcomeCache(new OutcomeCache(gCachePath));
+
+    if (gBenchmark)
+    {
+        ThroughputReport benchmark("tournament");
+        benchmark.Config("champion", gChampionStr);
+        benchmark.Config("opponent", gOpponentStr);
+        benchmark.Config("matches", gNumMatches);
+        benchmark.Config("seed", gSeed);
+        benchmark.Config("deals", gDealsPath != nullptr ? gDealsPath : "seeded");
+        benchmark.Config("threads", gJobs);
+        benchmark.Start();
+        tournament.runParallelTournament(gNumMatches, gDeals, gJobs, gSeed, gResultsPath);
+        benchmark.Finish(6 * gNumMatches);
+        benchmark.Write(gBenchmarkPath);
+    }
+    else if (gJobs > 0)
+    {
+        if (gSeed == 0)
+            gSeed = RandomGenerator::Random64();
+        printf("Seed: %llu\n", (unsigned long long) gSeed);
+        tournament.runParallelTournament(gNumMatches, gDeals, gJobs, gSeed, gResultsPath);
+    }
+    else
+    {
+        tournament.runOneTournament(gNumMatches, gDeals);
+    }
 
     return 0;
 }